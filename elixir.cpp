@@ -5,7 +5,9 @@
 #include "src/board/board.h"
 #include "src/defs.h"
 #include "src/hashing/hash.h"
+#include "src/movegen.h"
 #include "src/search.h"
+#include "src/tests/repetition_test.h"
 #include "src/tests/see_test.h"
 #include "src/tt.h"
 #include "src/tune.h"
@@ -19,6 +21,9 @@ using namespace elixir;
 void init() {
     zobrist::init_hash_keys();
     attacks::init_attacks();
+    init_psqt_deltas();
+    movegen::init_movegen();
+    cuckoo::init_cuckoo();
     // magic::init_magic_numbers();
     search::init_lmr();
 #ifdef USE_TUNE
@@ -34,10 +39,18 @@ int main(int argc, char *argv[]) {
             bench::bench();
             return 0;
         }
+        if (std::string(argv[1]) == "qbench") {
+            bench::qsearch_bench();
+            return 0;
+        }
         if (std::string(argv[1]) == "see") {
             tests::see_test();
             return 0;
         }
+        if (std::string(argv[1]) == "repetition") {
+            tests::repetition_test();
+            return 0;
+        }
         if (std::string(argv[1]) == "spsa") {
 #ifdef USE_TUNE
             tune::tuner.print_spsa_inputs();
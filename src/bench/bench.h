@@ -2,4 +2,5 @@
 
 namespace elixir::bench {
     void bench();
+    void qsearch_bench();
 }
\ No newline at end of file
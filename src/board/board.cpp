@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <cassert>
 #include <iostream>
 #include <string>
@@ -23,6 +24,33 @@ namespace elixir {
                                      15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15,
                                      15, 15, 15, 15, 7,  15, 15, 15, 3,  15, 15, 11};
 
+    // Rook source and target of each castling move, indexed by colour and wing (0 is king side)
+    constexpr Square castling_rook_hops[2][2][2] = {
+        {{Square::H1, Square::F1}, {Square::A1, Square::D1}},
+        {{Square::H8, Square::F8}, {Square::A8, Square::D8}}};
+
+    /*
+    | Change in material + PSQT score when a piece moves between two squares. Material cancels out, |
+    | so each entry is the difference of the two PSQT values, already flipped and signed by colour. |
+    */
+    EvalScore psqt_deltas[12][64][64];
+
+    void init_psqt_deltas() {
+        for (int piece = 0; piece < 12; piece++) {
+            const int piecetype = piece / 2;
+            const int color     = piece % 2;
+            // White squares are mirrored before indexing the PSQT, as in set_piece
+            const int flip = color == static_cast<int>(Color::WHITE) ? 56 : 0;
+            for (int from = 0; from < 64; from++) {
+                for (int to = 0; to < 64; to++) {
+                    psqt_deltas[piece][from][to] =
+                        (eval::psqt[piecetype][to ^ flip] - eval::psqt[piecetype][from ^ flip]) *
+                        color_offset[color];
+                }
+            }
+        }
+    }
+
     const std::string square_str[64] = {"a1", "b1", "c1", "d1", "e1", "f1", "g1", "h1", "a2", "b2",
                                         "c2", "d2", "e2", "f2", "g2", "h2", "a3", "b3", "c3", "d3",
                                         "e3", "f3", "g3", "h3", "a4", "b4", "c4", "d4", "e4", "f4",
@@ -108,44 +136,86 @@ namespace elixir {
         kings.fill(Square::NO_SQ);
         pieces.fill(Piece::NO_PIECE);
         undo_stack.clear();
+        key_history.clear();
         en_passant_square  = Square::NO_SQ;
         side               = Color::WHITE;
         castling_rights    = 0;
         fifty_move_counter = 0;
+        plies_from_null    = 0;
         fullmove_number    = 0;
         hash_key           = 0ULL;
+        pawn_key           = 0ULL;
         eval               = 0;
-        history.clear();
     }
 
     void Board::set_piece(const Square sq, const PieceType piece, const Color color) {
+        if (color == Color::WHITE)
+            set_piece<Color::WHITE>(sq, piece);
+        else
+            set_piece<Color::BLACK>(sq, piece);
+    }
+
+    void Board::remove_piece(const Square sq, const PieceType piece, const Color color) {
+        if (color == Color::WHITE)
+            remove_piece<Color::WHITE>(sq, piece);
+        else
+            remove_piece<Color::BLACK>(sq, piece);
+    }
+
+    template <Color C> void Board::set_piece(const Square sq, const PieceType piece) {
         assert(sq != Square::NO_SQ && piece != PieceType::NO_PIECE_TYPE);
-        bits::set_bit(b_occupancies[static_cast<I8>(color)], sq);
+        bits::set_bit(b_occupancies[static_cast<I8>(C)], sq);
         bits::set_bit(b_pieces[static_cast<I8>(piece)], sq);
         int square     = static_cast<I8>(sq);
-        pieces[square] = static_cast<Piece>(static_cast<I8>(piece) * 2 + static_cast<I8>(color));
-        if (color == Color::WHITE) {
+        pieces[square] = static_cast<Piece>(static_cast<I8>(piece) * 2 + static_cast<I8>(C));
+        if (piece == PieceType::PAWN) {
+            pawn_key ^= zobrist::piece_keys[static_cast<int>(C) * 6][square];
+        }
+        if constexpr (C == Color::WHITE) {
             square ^= 56;
         }
         eval += (eval::material_score[static_cast<I8>(piece)] +
                  eval::psqt[static_cast<I8>(piece)][square]) *
-                color_offset[static_cast<int>(color)];
+                color_offset[static_cast<int>(C)];
     }
 
-    void Board::remove_piece(const Square sq, const PieceType piece, const Color color) {
+    template <Color C>
+    void Board::move_piece(const Square from, const Square to, const PieceType piece) {
+        assert(from != Square::NO_SQ && to != Square::NO_SQ && piece != PieceType::NO_PIECE_TYPE);
+        const Bitboard mask = bits::bit(from) | bits::bit(to);
+        b_occupancies[static_cast<I8>(C)] ^= mask;
+        b_pieces[static_cast<I8>(piece)] ^= mask;
+        const int int_from = static_cast<int>(from);
+        const int int_to   = static_cast<int>(to);
+        const Piece moving = pieces[int_from];
+        assert(moving == static_cast<Piece>(static_cast<I8>(piece) * 2 + static_cast<I8>(C)));
+        assert(pieces[int_to] == Piece::NO_PIECE);
+        pieces[int_to]   = moving;
+        pieces[int_from] = Piece::NO_PIECE;
+        if (piece == PieceType::PAWN) {
+            pawn_key ^= zobrist::piece_keys[static_cast<int>(C) * 6][int_from] ^
+                        zobrist::piece_keys[static_cast<int>(C) * 6][int_to];
+        }
+        eval += psqt_deltas[static_cast<int>(moving)][int_from][int_to];
+    }
+
+    template <Color C> void Board::remove_piece(const Square sq, const PieceType piece) {
         assert(sq != Square::NO_SQ && piece != PieceType::NO_PIECE_TYPE);
-        bits::clear_bit(b_occupancies[static_cast<I8>(color)], sq);
+        bits::clear_bit(b_occupancies[static_cast<I8>(C)], sq);
         bits::clear_bit(b_pieces[static_cast<I8>(piece)], sq);
         int square = static_cast<int>(sq);
         assert(pieces[square] ==
-               static_cast<Piece>(static_cast<I8>(piece) * 2 + static_cast<I8>(color)));
+               static_cast<Piece>(static_cast<I8>(piece) * 2 + static_cast<I8>(C)));
         pieces[square] = Piece::NO_PIECE;
-        if (color == Color::WHITE) {
+        if (piece == PieceType::PAWN) {
+            pawn_key ^= zobrist::piece_keys[static_cast<int>(C) * 6][square];
+        }
+        if constexpr (C == Color::WHITE) {
             square ^= 56;
         }
         eval -= (eval::material_score[static_cast<I8>(piece)] +
                  eval::psqt[static_cast<I8>(piece)][square]) *
-                color_offset[static_cast<int>(color)];
+                color_offset[static_cast<int>(C)];
     }
 
     void Board::from_fen(const std::string fen) {
@@ -218,48 +288,63 @@ namespace elixir {
         from_fen(start_position);
     }
 
+    /*
+    | make_move and unmake_move look at the side to move once and hand over to a version that is |
+    | a template on it, so pawn directions, castling squares and colour indices are constants.   |
+    */
+    bool Board::make_move(move::Move move) {
+        if (side == Color::WHITE)
+            return make_move<Color::WHITE>(move);
+        return make_move<Color::BLACK>(move);
+    }
+
     void Board::unmake_move(const move::Move move, const bool from_make_move) {
+        // A completed make_move already passed the turn, so the mover is the other side
+        if (from_make_move)
+            side = static_cast<Color>(static_cast<int>(side) ^ 1);
+
+        if (side == Color::WHITE)
+            unmake_move<Color::WHITE>(move);
+        else
+            unmake_move<Color::BLACK>(move);
+    }
+
+    template <Color C> void Board::unmake_move(const move::Move move) {
+        constexpr Color enemy_side = C == Color::WHITE ? Color::BLACK : Color::WHITE;
+
         const Square from     = move.get_from();
         const Square to       = move.get_to();
-        const Piece piece     = move.get_piece();
         const move::Flag flag = move.get_flag();
 
-        const PieceType piecetype = piece_to_piecetype(piece);
-        int stm                   = static_cast<int>(side);
-        Color enemy_side          = static_cast<Color>(stm ^ 1);
-        int xstm                  = static_cast<int>(enemy_side);
-
-        if (from_make_move) {
-            std::swap(side, enemy_side);
-            std::swap(stm, xstm);
-        }
+        // The move does not carry the moving piece, so recover it from the target square
+        const PieceType piecetype =
+            move.is_promotion() ? PieceType::PAWN : piece_to_piecetype(piece_on(to));
 
         // Handling Pawn Promotion
         if (move.is_promotion()) {
             switch (move.get_promotion()) {
                 case move::Promotion::QUEEN:
-                    remove_piece(to, PieceType::QUEEN, side);
+                    remove_piece<C>(to, PieceType::QUEEN);
                     break;
                 case move::Promotion::ROOK:
-                    remove_piece(to, PieceType::ROOK, side);
+                    remove_piece<C>(to, PieceType::ROOK);
                     break;
                 case move::Promotion::KNIGHT:
-                    remove_piece(to, PieceType::KNIGHT, side);
+                    remove_piece<C>(to, PieceType::KNIGHT);
                     break;
                 case move::Promotion::BISHOP:
-                    remove_piece(to, PieceType::BISHOP, side);
+                    remove_piece<C>(to, PieceType::BISHOP);
                     break;
                 default:
                     break;
             }
+            set_piece<C>(from, piecetype);
         } else {
-            remove_piece(to, piecetype, side);
+            move_piece<C>(to, from, piecetype);
         }
 
-        set_piece(from, piecetype, side);
-
-        if (piece == Piece::wK || piece == Piece::bK) {
-            kings[static_cast<I8>(side)] = from;
+        if (piecetype == PieceType::KING) {
+            kings[static_cast<I8>(C)] = from;
         }
 
         State s              = undo_stack[undo_stack.size() - 1];
@@ -267,125 +352,100 @@ namespace elixir {
         castling_rights      = s.castling_rights;
         en_passant_square    = s.enpass;
         fifty_move_counter   = s.fifty_move_counter;
+        plies_from_null      = s.plies_from_null;
         Piece captured_piece = s.captured_piece;
 
-        if (side == Color::BLACK) {
+        if constexpr (C == Color::BLACK) {
             fullmove_number--;
         }
 
         // Handling Captures
         if (move.is_capture() && captured_piece != Piece::NO_PIECE) {
-            set_piece(to, piece_to_piecetype(captured_piece), enemy_side);
+            set_piece<enemy_side>(to, piece_to_piecetype(captured_piece));
         }
 
         // Handling En Passant
         if (flag == move::Flag::EN_PASSANT) {
             const int int_to       = static_cast<int>(to);
-            Square captured_square = static_cast<Square>(int_to + (side == Color::WHITE ? -8 : 8));
-            set_piece(captured_square, PieceType::PAWN, enemy_side);
+            Square captured_square = static_cast<Square>(int_to + (C == Color::WHITE ? -8 : 8));
+            set_piece<enemy_side>(captured_square, PieceType::PAWN);
         }
 
         // Handling Castling
         if (flag == move::Flag::CASTLING) {
-            switch (to) {
-                case Square::C1:
-                    remove_piece(Square::D1, PieceType::ROOK, Color::WHITE);
-                    set_piece(Square::A1, PieceType::ROOK, Color::WHITE);
-                    break;
-                case Square::G1:
-                    remove_piece(Square::F1, PieceType::ROOK, Color::WHITE);
-                    set_piece(Square::H1, PieceType::ROOK, Color::WHITE);
-                    break;
-                case Square::C8:
-                    remove_piece(Square::D8, PieceType::ROOK, Color::BLACK);
-                    set_piece(Square::A8, PieceType::ROOK, Color::BLACK);
-                    break;
-                case Square::G8:
-                    remove_piece(Square::F8, PieceType::ROOK, Color::BLACK);
-                    set_piece(Square::H8, PieceType::ROOK, Color::BLACK);
-                    break;
-                default:
-                    break;
-            }
+            const auto &hop = castling_rook_hops[static_cast<int>(C)][! (static_cast<int>(to) & 4)];
+            move_piece<C>(hop[1], hop[0], PieceType::ROOK);
         }
 
         undo_stack.pop_back();
+        key_history.pop_back();
 
         return;
     }
 
-    bool Board::make_move(move::Move move) {
+    template <Color C> bool Board::make_move(move::Move move) {
+        constexpr Color enemy_side = C == Color::WHITE ? Color::BLACK : Color::WHITE;
+        constexpr int stm          = static_cast<int>(C);
+        constexpr int xstm         = static_cast<int>(enemy_side);
+
         const Square from               = move.get_from();
         const Square to                 = move.get_to();
-        const Piece piece               = move.get_piece();
+        const Piece piece               = piece_on(from);
         const move::Flag flag           = move.get_flag();
         const move::Promotion promotion = move.get_promotion();
 
-        const int stm          = static_cast<int>(side);
-        const Color enemy_side = static_cast<Color>(stm ^ 1);
-        const int xstm         = static_cast<int>(enemy_side);
-
         const PieceType piecetype = piece_to_piecetype(piece);
 
-        const int int_piece = static_cast<int>(piece);
+        // Zobrist piece keys are indexed by piece type and colour, as in get_board_hash
+        const int int_piece = static_cast<int>(piecetype) + stm * 6;
         const int int_from  = static_cast<int>(from);
         const int int_to    = static_cast<int>(to);
 
-        const Piece piece_ = piece_on(from);
-
         assert(from != Square::NO_SQ && to != Square::NO_SQ);
         assert(from != to);
         assert(piece != Piece::NO_PIECE);
-        assert(piece_ == piece);
-        assert(piece_color(piece_) == side);
+        assert(piece_color(piece) == C);
 
         Piece captured_piece = piece_on(to);
         State s = State(hash_key, castling_rights, en_passant_square, fifty_move_counter,
-                        captured_piece, eval);
+                        plies_from_null, captured_piece, eval);
         undo_stack.push(s);
+        key_history.push(hash_key);
 
         eval = s.eval;
 
-        remove_piece(from, piecetype, side);
-        // Move source piece to target only if not a capturing move
-        // In case of a capture, moving of piece is handled in the "Handling Captures" section
-        if (! move.is_capture()) {
-
+        // Handling Captures
+        if (move.is_capture()) {
+            assert(captured_piece != Piece::NO_PIECE);
+            remove_piece<enemy_side>(to, piece_to_piecetype(captured_piece));
+            hash_key ^= zobrist::piece_keys[static_cast<int>(piece_to_piecetype(captured_piece)) +
+                                            xstm * 6][int_to];
+        } else {
             assert(captured_piece == Piece::NO_PIECE);
-
-            set_piece(to, piecetype, side);
         }
 
-        if (piece_ == Piece::wK || piece_ == Piece::bK) {
-            kings[static_cast<I8>(side)] = to;
+        move_piece<C>(from, to, piecetype);
+
+        if (piecetype == PieceType::KING) {
+            kings[stm] = to;
         }
 
         hash_key ^= zobrist::piece_keys[int_piece][int_from];
         hash_key ^= zobrist::piece_keys[int_piece][int_to];
 
         fifty_move_counter++;
-        if (side == Color::BLACK) {
+        plies_from_null++;
+        if constexpr (C == Color::BLACK) {
             fullmove_number++;
         }
 
-        if (piecetype == PieceType::PAWN) {
+        if (piecetype == PieceType::PAWN || move.is_capture()) {
             fifty_move_counter = 0;
         }
 
-        // Handling Captures
-        if (move.is_capture()) {
-            if (captured_piece != Piece::NO_PIECE) {
-                fifty_move_counter = 0;
-                remove_piece(to, piece_to_piecetype(captured_piece), enemy_side);
-                set_piece(to, piecetype, side);
-                hash_key ^=
-                    zobrist::piece_keys[static_cast<int>(captured_piece)][static_cast<int>(to)];
-            }
-        }
-
         // Handling Pawn Promotions
         if (move.is_promotion()) {
-            remove_piece(to, PieceType::PAWN, side);
+            remove_piece<C>(to, PieceType::PAWN);
             PieceType promotion_piece;
             switch (promotion) {
                 case move::Promotion::QUEEN:
@@ -407,7 +467,7 @@ namespace elixir {
 
             assert(promotion_piece != PieceType::NO_PIECE_TYPE);
 
-            set_piece(to, promotion_piece, side);
+            set_piece<C>(to, promotion_piece);
             hash_key ^= zobrist::piece_keys[int_piece][int_to];
             hash_key ^= zobrist::piece_keys[static_cast<int>(promotion_piece) + stm * 6][int_to];
         }
@@ -415,7 +475,7 @@ namespace elixir {
         // Handling En Passant
         if (flag == move::Flag::EN_PASSANT && en_passant_square != Square::NO_SQ) {
             Square captured_square = static_cast<Square>(int_to - 8 * color_offset[stm]);
-            remove_piece(captured_square, PieceType::PAWN, enemy_side);
+            remove_piece<enemy_side>(captured_square, PieceType::PAWN);
             hash_key ^= zobrist::piece_keys[static_cast<int>(PieceType::PAWN) + xstm * 6]
                                            [static_cast<int>(captured_square)];
         }
@@ -432,39 +492,15 @@ namespace elixir {
 
         // Handling Castling
         if (flag == move::Flag::CASTLING) {
-            int rook = static_cast<int>(PieceType::ROOK) + stm * 6;
-            switch (to) {
-                case Square::C1:
-                    remove_piece(Square::A1, PieceType::ROOK, Color::WHITE);
-                    set_piece(Square::D1, PieceType::ROOK, Color::WHITE);
-                    hash_key ^= zobrist::piece_keys[rook][static_cast<int>(Square::A1)];
-                    hash_key ^= zobrist::piece_keys[rook][static_cast<int>(Square::D1)];
-                    break;
-                case Square::G1:
-                    remove_piece(Square::H1, PieceType::ROOK, Color::WHITE);
-                    set_piece(Square::F1, PieceType::ROOK, Color::WHITE);
-                    hash_key ^= zobrist::piece_keys[rook][static_cast<int>(Square::H1)];
-                    hash_key ^= zobrist::piece_keys[rook][static_cast<int>(Square::F1)];
-                    break;
-                case Square::C8:
-                    remove_piece(Square::A8, PieceType::ROOK, Color::BLACK);
-                    set_piece(Square::D8, PieceType::ROOK, Color::BLACK);
-                    hash_key ^= zobrist::piece_keys[rook][static_cast<int>(Square::A8)];
-                    hash_key ^= zobrist::piece_keys[rook][static_cast<int>(Square::D8)];
-                    break;
-                case Square::G8:
-                    remove_piece(Square::H8, PieceType::ROOK, Color::BLACK);
-                    set_piece(Square::F8, PieceType::ROOK, Color::BLACK);
-                    hash_key ^= zobrist::piece_keys[rook][static_cast<int>(Square::H8)];
-                    hash_key ^= zobrist::piece_keys[rook][static_cast<int>(Square::F8)];
-                    break;
-                default:
-                    break;
-            }
+            constexpr int rook = static_cast<int>(PieceType::ROOK) + stm * 6;
+            const auto &hop    = castling_rook_hops[stm][! (int_to & 4)];
+            move_piece<C>(hop[0], hop[1], PieceType::ROOK);
+            hash_key ^= zobrist::piece_keys[rook][static_cast<int>(hop[0])];
+            hash_key ^= zobrist::piece_keys[rook][static_cast<int>(hop[1])];
         }
 
-        if (is_square_attacked(kings[static_cast<I8>(side)], enemy_side)) {
-            unmake_move(move, false);
+        if (is_square_attacked(kings[stm], enemy_side)) {
+            unmake_move<C>(move);
             return false;
         }
 
@@ -480,9 +516,11 @@ namespace elixir {
 
     void Board::make_null_move() {
         const State s = State(hash_key, castling_rights, en_passant_square, fifty_move_counter,
-                              Piece::NO_PIECE, eval);
+                              plies_from_null, Piece::NO_PIECE, eval);
         undo_stack.push(s);
+        key_history.push(hash_key);
         fifty_move_counter++;
+        plies_from_null = 0;
         if (en_passant_square != Square::NO_SQ) {
             hash_key ^= zobrist::ep_keys[static_cast<int>(en_passant_square)];
         }
@@ -494,8 +532,10 @@ namespace elixir {
     void Board::unmake_null_move() {
         const State s = undo_stack[undo_stack.size() - 1];
         undo_stack.pop_back();
+        key_history.pop_back();
         hash_key           = s.hash_key;
         fifty_move_counter = s.fifty_move_counter;
+        plies_from_null    = s.plies_from_null;
         en_passant_square  = s.enpass;
         castling_rights    = s.castling_rights;
         eval               = s.eval;
@@ -564,7 +604,7 @@ namespace elixir {
         }
 
         move::Move m;
-        m.set_move(from, to, piece, flag, promotion);
+        m.set_move(from, to, flag, promotion);
         return m;
     }
 
@@ -574,10 +614,12 @@ namespace elixir {
     }
 
     bool Board::is_repetition() const {
-        const auto limit = std::max<int>(0, undo_stack.size() - fifty_move_counter - 2);
-        int counter      = 1;
-        for (int i = undo_stack.size() - 4; i >= limit; i -= 2) {
-            if (undo_stack[i].hash_key == hash_key) {
+        const int size = key_history.size();
+        // Positions before the last null move were not reached by real moves
+        const int limit = std::max({0, size - fifty_move_counter - 2, size - plies_from_null});
+        int counter     = 1;
+        for (int i = size - 4; i >= limit; i -= 2) {
+            if (key_history[i] == hash_key) {
                 if (--counter == 0) {
                     return true;
                 }
@@ -585,4 +627,45 @@ namespace elixir {
         }
         return false;
     }
+
+    /*
+    | Upcoming repetition detection (Marcel van Kervinck's cuckoo method) : if the current key and |
+    | a key an odd number of plies back differ by exactly one reversible move, and nothing stands  |
+    | in that move's path, then the position can be repeated with a single move.                   |
+    */
+    bool Board::has_upcoming_repetition(int ply) const {
+        const int size = key_history.size();
+        const int end  = std::min<int>({fifty_move_counter, plies_from_null, size});
+        if (end < 3)
+            return false;
+
+        const Bitboard occupied = occupancy();
+        for (int i = 3; i <= end; i += 2) {
+            const U64 move_key = hash_key ^ key_history[size - i];
+
+            int slot = cuckoo::h1(move_key);
+            if (cuckoo::keys[slot] != move_key) {
+                slot = cuckoo::h2(move_key);
+                if (cuckoo::keys[slot] != move_key)
+                    continue;
+            }
+
+            const Square from = cuckoo::moves[slot].from;
+            const Square to   = cuckoo::moves[slot].to;
+
+            // Squares strictly between from and to; empty for knight and king moves
+            Bitboard between = 0ULL;
+            if (get_rank(from) == get_rank(to) || get_file(from) == get_file(to))
+                between = attacks::get_rook_attacks(from, bits::bit(to)) &
+                          attacks::get_rook_attacks(to, bits::bit(from));
+            else
+                between = attacks::get_bishop_attacks(from, bits::bit(to)) &
+                          attacks::get_bishop_attacks(to, bits::bit(from));
+
+            // Only count repetitions inside the search tree; earlier ones need a real repeat
+            if (! (between & occupied) && ply > i)
+                return true;
+        }
+        return false;
+    }
 }
\ No newline at end of file
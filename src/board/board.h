@@ -6,7 +6,6 @@
 
 #include "../attacks/attacks.h"
 #include "../defs.h"
-#include "../history.h"
 #include "../move.h"
 #include "../types.h"
 #include "../utils/bits.h"
@@ -17,6 +16,9 @@ namespace elixir {
     extern const std::string square_str[64];
     void print_square(const Square sq);
 
+    extern EvalScore psqt_deltas[12][64][64];
+    void init_psqt_deltas();
+
     class Board {
       public:
         Board() { clear_board(); }
@@ -145,6 +147,7 @@ namespace elixir {
         }
 
         [[nodiscard]] U64 get_board_hash();
+        [[nodiscard]] U64 get_polyglot_key() const;
 
         void set_piece(const Square sq, const PieceType piece, const Color color);
         void remove_piece(const Square sq, const PieceType piece, const Color color);
@@ -172,9 +175,11 @@ namespace elixir {
         [[nodiscard]] I8 get_fifty_move_counter() const noexcept { return fifty_move_counter; }
         [[nodiscard]] I16 get_fullmove_number() const noexcept { return fullmove_number; }
         [[nodiscard]] U64 get_hash_key() const noexcept { return hash_key; }
+        [[nodiscard]] U64 get_pawn_key() const noexcept { return pawn_key; }
         [[nodiscard]] EvalScore get_eval() const noexcept { return eval; }
 
-        [[nodiscard]] Bitboard get_attackers(Square sq, Color c, Bitboard occupancy) const {
+        // Attackers of both colours
+        [[nodiscard]] Bitboard get_attackers(Square sq, Bitboard occupancy) const {
             Bitboard attackers = 0ULL;
             attackers |= (attacks::get_pawn_attacks(Color::WHITE, sq) & black_pawns());
             attackers |= (attacks::get_pawn_attacks(Color::BLACK, sq) & white_pawns());
@@ -182,7 +187,11 @@ namespace elixir {
             attackers |= (attacks::get_bishop_attacks(sq, occupancy) & (bishops() | queens()));
             attackers |= (attacks::get_rook_attacks(sq, occupancy) & (rooks() | queens()));
             attackers |= (attacks::get_king_attacks(sq) & king());
-            return attackers & color_occupancy(c);
+            return attackers;
+        }
+
+        [[nodiscard]] Bitboard get_attackers(Square sq, Color c, Bitboard occupancy) const {
+            return get_attackers(sq, occupancy) & color_occupancy(c);
         }
 
         [[nodiscard]] Bitboard get_attackers(Square sq, Color c) const {
@@ -214,21 +223,33 @@ namespace elixir {
         bool play_uci_move(const std::string move);
 
         bool is_repetition() const;
-
-        History history;
+        bool has_upcoming_repetition(int ply) const;
 
       private:
+        template <Color C> void set_piece(const Square sq, const PieceType piece);
+        template <Color C> void remove_piece(const Square sq, const PieceType piece);
+        template <Color C>
+        void move_piece(const Square from, const Square to, const PieceType piece);
+        template <Color C> bool make_move(move::Move move);
+        template <Color C> void unmake_move(const move::Move move);
+
         std::array<Bitboard, 2> b_occupancies{};
         std::array<Bitboard, 6> b_pieces{};
         std::array<Square, 2> kings{};
         std::array<Piece, 64> pieces{};
         StaticVector<State, 1024> undo_stack;
+        // Hash keys of the positions before each move, kept apart from the undo stack for fast
+        // repetition scans
+        StaticVector<U64, 1024> key_history;
         Square en_passant_square;
         Color side;
         Castling castling_rights;
         I8 fifty_move_counter;
+        // Plies played since the last null move; repetition scans must not look past it
+        I16 plies_from_null;
         I16 fullmove_number;
         U64 hash_key;
+        U64 pawn_key;
         EvalScore eval;
     };
 }
\ No newline at end of file
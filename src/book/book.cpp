@@ -0,0 +1,213 @@
+#include <random>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "book.h"
+
+#include "../board/board.h"
+#include "../move.h"
+#include "../movegen.h"
+#include "../types.h"
+
+namespace elixir::book {
+    PolyglotBook book;
+
+    constexpr std::size_t ENTRY_SIZE = 16;
+
+    static U64 read_be(const unsigned char *bytes, int n) {
+        U64 value = 0ULL;
+        for (int i = 0; i < n; i++) {
+            value = (value << 8) | bytes[i];
+        }
+        return value;
+    }
+
+    bool PolyglotBook::open(const std::string &path) {
+        close();
+        if (path.empty())
+            return false;
+
+#ifdef _WIN32
+        HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                                  OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE)
+            return false;
+
+        LARGE_INTEGER file_size;
+        if (! GetFileSizeEx(file, &file_size) || file_size.QuadPart < (LONGLONG)ENTRY_SIZE) {
+            CloseHandle(file);
+            return false;
+        }
+
+        HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (mapping == nullptr) {
+            CloseHandle(file);
+            return false;
+        }
+
+        void *view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+        if (view == nullptr) {
+            CloseHandle(mapping);
+            CloseHandle(file);
+            return false;
+        }
+
+        file_handle    = file;
+        mapping_handle = mapping;
+        size           = static_cast<std::size_t>(file_size.QuadPart);
+#else
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+            return false;
+
+        struct stat st;
+        if (fstat(fd, &st) != 0 || st.st_size < static_cast<off_t>(ENTRY_SIZE)) {
+            ::close(fd);
+            return false;
+        }
+
+        void *view = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        // The mapping stays valid after the descriptor is closed
+        ::close(fd);
+        if (view == MAP_FAILED)
+            return false;
+
+        size = static_cast<std::size_t>(st.st_size);
+#endif
+        data  = static_cast<const unsigned char *>(view);
+        count = size / ENTRY_SIZE;
+        return true;
+    }
+
+    void PolyglotBook::close() {
+        if (data == nullptr)
+            return;
+#ifdef _WIN32
+        UnmapViewOfFile(data);
+        CloseHandle(static_cast<HANDLE>(mapping_handle));
+        CloseHandle(static_cast<HANDLE>(file_handle));
+        mapping_handle = nullptr;
+        file_handle    = nullptr;
+#else
+        munmap(const_cast<unsigned char *>(data), size);
+#endif
+        data  = nullptr;
+        size  = 0;
+        count = 0;
+    }
+
+    PolyglotEntry PolyglotBook::entry_at(std::size_t index) const {
+        const unsigned char *bytes = data + index * ENTRY_SIZE;
+        PolyglotEntry entry;
+        entry.key    = read_be(bytes, 8);
+        entry.move   = static_cast<U16>(read_be(bytes + 8, 2));
+        entry.weight = static_cast<U16>(read_be(bytes + 10, 2));
+        entry.learn  = static_cast<U32>(read_be(bytes + 12, 4));
+        return entry;
+    }
+
+    std::size_t PolyglotBook::lower_bound(U64 key) const {
+        // Entries are sorted by key, so binary search for the first entry of the position
+        std::size_t low = 0, high = count;
+        while (low < high) {
+            const std::size_t mid = low + (high - low) / 2;
+            if (read_be(data + mid * ENTRY_SIZE, 8) < key)
+                low = mid + 1;
+            else
+                high = mid;
+        }
+        return low;
+    }
+
+    move::Move PolyglotBook::to_move(Board &board, U16 poly_move) const {
+        const int to_file   = poly_move & 7;
+        const int to_row    = (poly_move >> 3) & 7;
+        const int from_file = (poly_move >> 6) & 7;
+        const int from_row  = (poly_move >> 9) & 7;
+        const int promotion = (poly_move >> 12) & 7;
+
+        Square from = static_cast<Square>(from_row * 8 + from_file);
+        Square to   = static_cast<Square>(to_row * 8 + to_file);
+
+        // Polyglot encodes castling as the king capturing its own rook
+        const Piece piece = board.piece_on(from);
+        if (piece == Piece::wK && from == Square::E1) {
+            if (to == Square::H1)
+                to = Square::G1;
+            else if (to == Square::A1)
+                to = Square::C1;
+        } else if (piece == Piece::bK && from == Square::E8) {
+            if (to == Square::H8)
+                to = Square::G8;
+            else if (to == Square::A8)
+                to = Square::C8;
+        }
+
+        constexpr move::Promotion promotions[5] = {move::Promotion::QUEEN, move::Promotion::KNIGHT,
+                                                   move::Promotion::BISHOP, move::Promotion::ROOK,
+                                                   move::Promotion::QUEEN};
+
+        MoveList moves;
+        movegen::generate_moves<false>(board, moves);
+        for (const auto &move : moves) {
+            if (move.get_from() != from || move.get_to() != to)
+                continue;
+            if (move.is_promotion() != (promotion != 0))
+                continue;
+            if (promotion && move.get_promotion() != promotions[promotion])
+                continue;
+
+            // Only hand out moves that are legal in the current position
+            if (! board.make_move(move))
+                return move::NO_MOVE;
+            board.unmake_move(move, true);
+            return move;
+        }
+
+        return move::NO_MOVE;
+    }
+
+    move::Move PolyglotBook::probe(Board &board) const {
+        if (! is_open())
+            return move::NO_MOVE;
+
+        const U64 key = board.get_polyglot_key();
+
+        std::vector<PolyglotEntry> entries;
+        U32 total_weight = 0;
+        for (std::size_t i = lower_bound(key); i < count; i++) {
+            const PolyglotEntry entry = entry_at(i);
+            if (entry.key != key)
+                break;
+            entries.push_back(entry);
+            total_weight += entry.weight;
+        }
+
+        if (entries.empty())
+            return move::NO_MOVE;
+
+        static std::mt19937 rng(std::random_device{}());
+
+        // Pick a move with probability proportional to its weight; if every weight is zero, fall
+        // back to the first (and usually best) entry
+        std::size_t choice = 0;
+        if (total_weight > 0) {
+            U32 pick = std::uniform_int_distribution<U32>(0, total_weight - 1)(rng);
+            for (choice = 0; choice < entries.size(); choice++) {
+                if (pick < entries[choice].weight)
+                    break;
+                pick -= entries[choice].weight;
+            }
+        }
+
+        return to_move(board, entries[choice].move);
+    }
+}
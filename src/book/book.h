@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+#include "../board/board.h"
+#include "../move.h"
+#include "../types.h"
+
+namespace elixir::book {
+    // A single 16 byte Polyglot entry, stored big-endian on disk
+    struct PolyglotEntry {
+        U64 key;
+        U16 move;
+        U16 weight;
+        U32 learn;
+    };
+
+    class PolyglotBook {
+      public:
+        PolyglotBook() = default;
+        ~PolyglotBook() { close(); }
+
+        PolyglotBook(const PolyglotBook &)            = delete;
+        PolyglotBook &operator=(const PolyglotBook &) = delete;
+
+        bool open(const std::string &path);
+        void close();
+
+        [[nodiscard]] bool is_open() const noexcept { return data != nullptr; }
+
+        // Returns a weighted random book move for the position, or NO_MOVE if out of book
+        move::Move probe(Board &board) const;
+
+        bool enabled = false;
+
+      private:
+        PolyglotEntry entry_at(std::size_t index) const;
+        std::size_t lower_bound(U64 key) const;
+        move::Move to_move(Board &board, U16 poly_move) const;
+
+        const unsigned char *data = nullptr;
+        std::size_t size          = 0;
+        std::size_t count         = 0;
+#ifdef _WIN32
+        void *file_handle    = nullptr;
+        void *mapping_handle = nullptr;
+#endif
+    };
+
+    extern PolyglotBook book;
+}
@@ -137,6 +137,17 @@ namespace elixir {
     constexpr int DEFAULT_HASH_SIZE = 64;
     constexpr int MAX_HASH          = 1024;
 
+    // MultiPV terms
+    constexpr int MIN_MULTIPV     = 1;
+    constexpr int DEFAULT_MULTIPV = 1;
+    constexpr int MAX_MULTIPV     = 218;
+
+    // Correction history terms
+    constexpr int CORRECTION_HISTORY_SIZE  = 16384;
+    constexpr int CORRECTION_HISTORY_GRAIN = 256;
+    constexpr int CORRECTION_HISTORY_SCALE = 256;
+    constexpr int CORRECTION_HISTORY_MAX   = CORRECTION_HISTORY_GRAIN * 32;
+
     static inline int get_rank(Square sq) {
         return (static_cast<int>(sq) >> 3) & 7;
     }
@@ -1,5 +1,6 @@
 #pragma once
 
+#include "../defs.h"
 #include "../types.h"
 
 namespace elixir {
@@ -16,4 +17,35 @@ namespace elixir {
 
         void init_hash_keys();
     }
+
+    /*
+    | Cuckoo tables of every reversible piece move, keyed by the Zobrist difference the move makes. |
+    | They let the search spot a move that would repeat an earlier position.                        |
+    */
+    namespace cuckoo {
+        constexpr int SIZE = 8192;
+
+        struct CuckooMove {
+            Square from = Square::NO_SQ;
+            Square to   = Square::NO_SQ;
+        };
+
+        extern U64 keys[SIZE];
+        extern CuckooMove moves[SIZE];
+
+        constexpr int h1(U64 key) { return key & 0x1fff; }
+        constexpr int h2(U64 key) { return (key >> 16) & 0x1fff; }
+
+        void init_cuckoo();
+    }
+
+    namespace polyglot {
+        // Random64 table from the Polyglot book format specification
+        constexpr int RANDOM_PIECE      = 0;
+        constexpr int RANDOM_CASTLE     = 768;
+        constexpr int RANDOM_EN_PASSANT = 772;
+        constexpr int RANDOM_TURN       = 780;
+
+        extern const U64 random64[781];
+    }
 }
\ No newline at end of file
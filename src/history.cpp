@@ -1,3 +1,6 @@
+#include <algorithm>
+#include <span>
+
 #include "history.h"
 #include "defs.h"
 #include "move.h"
@@ -6,22 +9,44 @@
 namespace elixir {
     int HISTORY_GRAVITY = 8289;
 
+    History history[1];
+
     void History::clear() {
-        for (int i = 0; i < 64; i++) {
+        std::fill(&butterfly_history[0][0][0], &butterfly_history[0][0][0] + 2 * 64 * 64, 0);
+        std::fill(&continuation_history[0][0][0][0],
+                  &continuation_history[0][0][0][0] + 12 * 64 * 12 * 64, 0);
+        for (int i = 0; i < 12; i++) {
             for (int j = 0; j < 64; j++) {
-                history[i][j] = 0;
+                counter_moves[i][j] = move::NO_MOVE;
             }
         }
+        std::fill(&capture_history[0][0][0], &capture_history[0][0][0] + 12 * 64 * 6, 0);
+        std::fill(&correction_history[0][0], &correction_history[0][0] + 2 * CORRECTION_HISTORY_SIZE,
+                  0);
+    }
+
+    void History::age() {
+        for (auto &score : std::span(&butterfly_history[0][0][0], 2 * 64 * 64)) {
+            score /= 2;
+        }
+        for (auto &score : std::span(&continuation_history[0][0][0][0], 12 * 64 * 12 * 64)) {
+            score /= 2;
+        }
+        for (auto &score : std::span(&capture_history[0][0][0], 12 * 64 * 6)) {
+            score /= 2;
+        }
     }
 
     int History::scale_bonus(int score, int bonus) {
         return bonus - score * std::abs(bonus) / HISTORY_GRAVITY;
     }
 
-    void History::update_history(Square from, Square to, int depth, MoveList &bad_quiets) {
-        int ifrom  = static_cast<int>(from);
-        int ito    = static_cast<int>(to);
-        int &score = history[ifrom][ito];
+    void History::update_history(Color side, Square from, Square to, int depth,
+                                 MoveList &bad_quiets) {
+        auto &history = butterfly_history[static_cast<int>(side)];
+        int ifrom     = static_cast<int>(from);
+        int ito       = static_cast<int>(to);
+        int &score    = history[ifrom][ito];
         score += scale_bonus(score, depth * depth);
 
         const int penalty = -depth * depth;
@@ -34,7 +59,86 @@ namespace elixir {
         }
     }
 
-    int History::get_history(Square from, Square to) const {
-        return history[static_cast<int>(from)][static_cast<int>(to)];
+    int History::get_history(Color side, Square from, Square to) const {
+        return butterfly_history[static_cast<int>(side)][static_cast<int>(from)]
+                                [static_cast<int>(to)];
+    }
+
+    int &History::continuation_entry(Piece previous_piece, move::Move previous, Piece piece,
+                                     move::Move move) {
+        return continuation_history[static_cast<int>(previous_piece)]
+                                   [static_cast<int>(previous.get_to())][static_cast<int>(piece)]
+                                   [static_cast<int>(move.get_to())];
+    }
+
+    void History::update_continuation_history(const Board &board, Piece previous_piece,
+                                              move::Move previous, move::Move move, int depth,
+                                              MoveList &bad_quiets) {
+        if (previous == move::NO_MOVE)
+            return;
+
+        int &score =
+            continuation_entry(previous_piece, previous, board.piece_on(move.get_from()), move);
+        score += scale_bonus(score, depth * depth);
+
+        const int penalty = -depth * depth;
+        for (const auto &bad_quiet : bad_quiets) {
+            int &bad_quiet_score = continuation_entry(previous_piece, previous,
+                                                      board.piece_on(bad_quiet.get_from()),
+                                                      bad_quiet);
+            bad_quiet_score += scale_bonus(bad_quiet_score, penalty);
+        }
+    }
+
+    int History::get_continuation_history(Piece previous_piece, move::Move previous, Piece piece,
+                                          move::Move move) const {
+        if (previous == move::NO_MOVE)
+            return 0;
+        return continuation_history[static_cast<int>(previous_piece)]
+                                   [static_cast<int>(previous.get_to())][static_cast<int>(piece)]
+                                   [static_cast<int>(move.get_to())];
+    }
+
+    void History::update_counter_move(Piece previous_piece, move::Move previous,
+                                      move::Move move) {
+        if (previous == move::NO_MOVE)
+            return;
+        counter_moves[static_cast<int>(previous_piece)][static_cast<int>(previous.get_to())] = move;
+    }
+
+    void History::update_capture_history(Piece piece, move::Move move, PieceType captured,
+                                         int bonus) {
+        int &score = capture_history[static_cast<int>(piece)][static_cast<int>(move.get_to())]
+                                    [static_cast<int>(captured)];
+        score += scale_bonus(score, bonus);
+    }
+
+    int History::get_capture_history(Piece piece, move::Move move, PieceType captured) const {
+        return capture_history[static_cast<int>(piece)][static_cast<int>(move.get_to())]
+                              [static_cast<int>(captured)];
+    }
+
+    void History::update_correction_history(Color side, U64 pawn_key, int depth, int diff) {
+        int &entry = correction_history[static_cast<int>(side)][pawn_key % CORRECTION_HISTORY_SIZE];
+
+        // Deeper searches are trusted more, so they move the running average further
+        const int weight = std::min(depth + 1, 16);
+        const int target = diff * CORRECTION_HISTORY_GRAIN;
+        entry = (entry * (CORRECTION_HISTORY_SCALE - weight) + target * weight) /
+                CORRECTION_HISTORY_SCALE;
+        entry = std::clamp(entry, -CORRECTION_HISTORY_MAX, CORRECTION_HISTORY_MAX);
+    }
+
+    int History::correct_eval(Color side, U64 pawn_key, int raw_eval) const {
+        const int correction =
+            correction_history[static_cast<int>(side)][pawn_key % CORRECTION_HISTORY_SIZE];
+        return std::clamp(raw_eval + correction / CORRECTION_HISTORY_GRAIN, -MATE_FOUND + 1,
+                          MATE_FOUND - 1);
+    }
+
+    move::Move History::get_counter_move(Piece previous_piece, move::Move previous) const {
+        if (previous == move::NO_MOVE)
+            return move::NO_MOVE;
+        return counter_moves[static_cast<int>(previous_piece)][static_cast<int>(previous.get_to())];
     }
 }
\ No newline at end of file
@@ -1,5 +1,6 @@
 #pragma once
 
+#include "board/board.h"
 #include "defs.h"
 #include "move.h"
 #include "types.h"
@@ -8,15 +9,62 @@ namespace elixir {
     extern int HISTORY_GRAVITY;
     class History {
       public:
-        History()  = default;
+        History() { clear(); }
         ~History() = default;
 
         void clear();
-        void update_history(Square from, Square to, int depth, MoveList &bad_quiets);
-        int get_history(Square from, Square to) const;
+
+        /*
+        | Called before every search. Scores from earlier moves of the game still order moves, but |
+        | fresh results quickly outweigh them.                                                     |
+        */
+        void age();
+
+        void update_history(Color side, Square from, Square to, int depth, MoveList &bad_quiets);
+        int get_history(Color side, Square from, Square to) const;
+
+        /*
+        | Continuation history is indexed by the piece and target square of an earlier move and of |
+        | the current move. One table serves both the 1-ply and the 2-ply continuation. Moves do   |
+        | not carry the moving piece, so the earlier piece is passed in and the pieces of the      |
+        | current moves are read from the board they are played on.                                |
+        */
+        void update_continuation_history(const Board &board, Piece previous_piece,
+                                         move::Move previous, move::Move move, int depth,
+                                         MoveList &bad_quiets);
+        int get_continuation_history(Piece previous_piece, move::Move previous, Piece piece,
+                                     move::Move move) const;
+
+        void update_counter_move(Piece previous_piece, move::Move previous, move::Move move);
+        move::Move get_counter_move(Piece previous_piece, move::Move previous) const;
+
+        /*
+        | Capture history is indexed by the moving piece, the target square and the captured piece |
+        | type.                                                                                    |
+        */
+        void update_capture_history(Piece piece, move::Move move, PieceType captured, int bonus);
+        int get_capture_history(Piece piece, move::Move move, PieceType captured) const;
+
+        /*
+        | Correction history tracks, per side and pawn structure, how far the static eval has been |
+        | from the search result, and shifts future static evals by that amount.                   |
+        */
+        void update_correction_history(Color side, U64 pawn_key, int depth, int diff);
+        int correct_eval(Color side, U64 pawn_key, int raw_eval) const;
 
       private:
         int scale_bonus(int score, int bonus);
-        int history[64][64] = {0};
+        int &continuation_entry(Piece previous_piece, move::Move previous, Piece piece,
+                                move::Move move);
+        int butterfly_history[2][64][64]         = {};
+        int continuation_history[12][64][12][64] = {};
+        move::Move counter_moves[12][64];
+        int capture_history[12][64][6]                     = {};
+        int correction_history[2][CORRECTION_HISTORY_SIZE] = {};
     };
+
+    /*
+    | Move ordering history shared by every search of a game. Only ucinewgame clears it. |
+    */
+    extern History history[1];
 }
\ No newline at end of file
@@ -10,42 +10,58 @@ namespace elixir::move {
         set_move(move);
     }
 
-    Move::Move(Square from, Square to, Piece piece, Flag flag, Promotion promotion) {
-        set_move(from, to, piece, flag, promotion);
+    Move::Move(Square from, Square to, Flag flag, Promotion promotion) {
+        set_move(from, to, flag, promotion);
     }
 
-    [[nodiscard]] Move_T Move::encode_move(Square from, Square to, Piece piece, Flag flag,
+    [[nodiscard]] Move_T Move::encode_move(Square from, Square to, Flag flag,
                                            Promotion promotion) const noexcept {
+        int code;
+        switch (flag) {
+            case Flag::PROMOTION:
+                code = PROMOTION_BIT | static_cast<int>(promotion);
+                break;
+            case Flag::CAPTURE_PROMOTION:
+                code = PROMOTION_BIT | CAPTURE_PROMOTION_BIT | static_cast<int>(promotion);
+                break;
+            default:
+                code = static_cast<int>(flag);
+                break;
+        }
+
         Move_T move = 0;
         move |= static_cast<Move_T>(from);
         move |= static_cast<Move_T>(to) << 6;
-        move |= static_cast<Move_T>(piece) << 12;
-        move |= static_cast<Move_T>(flag) << 16;
-        move |= static_cast<Move_T>(promotion) << 19;
+        move |= static_cast<Move_T>(code) << 12;
         return move;
     }
 
-    void Move::print_uci() const {
-        std::cout << square_str[static_cast<int>(get_from())];
-        std::cout << square_str[static_cast<int>(get_to())];
+    [[nodiscard]] std::string Move::to_uci() const {
+        std::string uci = square_str[static_cast<int>(get_from())];
+        uci += square_str[static_cast<int>(get_to())];
         if (is_promotion()) {
             Promotion promotion = get_promotion();
             switch (promotion) {
                 case Promotion::QUEEN:
-                    std::cout << "q";
+                    uci += "q";
                     break;
                 case Promotion::ROOK:
-                    std::cout << "r";
+                    uci += "r";
                     break;
                 case Promotion::KNIGHT:
-                    std::cout << "n";
+                    uci += "n";
                     break;
                 case Promotion::BISHOP:
-                    std::cout << "b";
+                    uci += "b";
                     break;
                 default:
                     break;
             }
         }
+        return uci;
+    }
+
+    void Move::print_uci() const {
+        std::cout << to_uci();
     }
 }
\ No newline at end of file
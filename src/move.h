@@ -1,5 +1,7 @@
 #pragma once
 
+#include <string>
+
 #include "defs.h"
 #include "types.h"
 #include "utils/static_vector.h"
@@ -20,14 +22,19 @@ namespace elixir::move {
         BISHOP,
         KNIGHT,
     };
+    /*
+    | A move is packed into 16 bits: from (6) | to (6) | code (4). The moving piece is not stored |
+    | and is read from the board mailbox instead. Codes 0-4 are the plain flags, bit 3 marks a    |
+    | promotion, bit 2 a capture promotion and the low 2 bits carry the promotion piece.          |
+    */
     class Move {
       public:
         Move() = default;
         Move(Move_T move);
-        Move(Square from, Square to, Piece piece, Flag flag, Promotion promotion);
+        Move(Square from, Square to, Flag flag, Promotion promotion);
         ~Move() = default;
 
-        [[nodiscard]] Move_T encode_move(Square from, Square to, Piece piece, Flag flag,
+        [[nodiscard]] Move_T encode_move(Square from, Square to, Flag flag,
                                          Promotion promotion) const noexcept;
 
         [[nodiscard]] constexpr Square get_from() const noexcept {
@@ -36,26 +43,27 @@ namespace elixir::move {
         [[nodiscard]] constexpr Square get_to() const noexcept {
             return static_cast<Square>((m_move >> 6) & 0x3f);
         }
-        [[nodiscard]] constexpr Piece get_piece() const noexcept {
-            return static_cast<Piece>((m_move >> 12) & 0xf);
-        }
         [[nodiscard]] constexpr Flag get_flag() const noexcept {
-            return static_cast<Flag>((m_move >> 16) & 0x7);
+            const int code = m_move >> 12;
+            if (code & PROMOTION_BIT)
+                return (code & CAPTURE_PROMOTION_BIT) ? Flag::CAPTURE_PROMOTION : Flag::PROMOTION;
+            return static_cast<Flag>(code);
         }
         [[nodiscard]] constexpr Promotion get_promotion() const noexcept {
-            return static_cast<Promotion>((m_move >> 19) & 0x3);
+            return static_cast<Promotion>((m_move >> 12) & 0x3);
         }
         [[nodiscard]] constexpr Move_T get_move() const noexcept { return m_move; }
 
         void set_move(Move_T move) noexcept { m_move = move; }
-        void set_move(Square from, Square to, Piece piece, Flag flag,
-                      Promotion promotion) noexcept {
-            m_move = encode_move(from, to, piece, flag, promotion);
+        void set_move(Square from, Square to, Flag flag, Promotion promotion) noexcept {
+            m_move = encode_move(from, to, flag, promotion);
         }
 
         [[nodiscard]] constexpr bool is_capture() const noexcept {
-            Flag f = get_flag();
-            return f == Flag::CAPTURE || f == Flag::CAPTURE_PROMOTION;
+            const int code = m_move >> 12;
+            return code == static_cast<int>(Flag::CAPTURE) ||
+                   (code & (PROMOTION_BIT | CAPTURE_PROMOTION_BIT)) ==
+                       (PROMOTION_BIT | CAPTURE_PROMOTION_BIT);
         }
         [[nodiscard]] constexpr bool is_double_pawn_push() const noexcept {
             return get_flag() == Flag::DOUBLE_PAWN_PUSH;
@@ -67,7 +75,7 @@ namespace elixir::move {
             return get_flag() == Flag::CASTLING;
         }
         [[nodiscard]] constexpr bool is_promotion() const noexcept {
-            return get_flag() == Flag::PROMOTION || get_flag() == Flag::CAPTURE_PROMOTION;
+            return (m_move >> 12) & PROMOTION_BIT;
         }
         [[nodiscard]] constexpr bool is_normal() const noexcept {
             return get_flag() == Flag::NORMAL;
@@ -78,9 +86,13 @@ namespace elixir::move {
 
         bool operator==(const Move &other) const noexcept { return m_move == other.m_move; }
 
+        [[nodiscard]] std::string to_uci() const;
         void print_uci() const;
 
       private:
+        static constexpr int PROMOTION_BIT         = 0b1000;
+        static constexpr int CAPTURE_PROMOTION_BIT = 0b0100;
+
         Move_T m_move;
     };
     const Move NO_MOVE = Move(0);
@@ -1,7 +1,14 @@
+#include <array>
+#include <bit>
 #include <cassert>
 #include <iostream>
 #include <vector>
 
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#include <immintrin.h>
+#define MOVEGEN_AVX512
+#endif
+
 #include "movegen.h"
 
 #include "defs.h"
@@ -10,68 +17,128 @@
 #include "utils/static_vector.h"
 
 namespace elixir::movegen {
-    template <bool noisy> void generate_pawn_moves(const Board &board, MoveList &moves) {
-        Color side = board.get_side_to_move();
-        I8 stm     = static_cast<int>(side);
-        Bitboard pawns =
-            side == Color::WHITE ? board.pawns<Color::WHITE>() : board.pawns<Color::BLACK>();
+    bool use_avx512 = false;
+
+    void init_movegen() {
+#ifdef MOVEGEN_AVX512
+        __builtin_cpu_init();
+        use_avx512 =
+            __builtin_cpu_supports("avx512bw") && __builtin_cpu_supports("avx512vbmi2");
+#endif
+    }
+
+    /*
+    | Move words for each target square before the source and flag are added. A piece with a   |
+    | fixed source adds from | code << 12 to to << 6; a pawn set, whose source is the target   |
+    | minus a constant, adds code << 12 - offset to to | to << 6.                              |
+    */
+    template <bool pawn> constexpr std::array<Move_T, 64> make_target_words() {
+        std::array<Move_T, 64> words{};
+        for (int to = 0; to < 64; to++)
+            words[to] = static_cast<Move_T>(pawn ? to | to << 6 : to << 6);
+        return words;
+    }
+
+    alignas(64) constexpr std::array<Move_T, 64> piece_target_words = make_target_words<false>();
+    alignas(64) constexpr std::array<Move_T, 64> pawn_target_words  = make_target_words<true>();
+
+    static_assert(sizeof(move::Move) == sizeof(Move_T));
+
+#ifdef MOVEGEN_AVX512
+    /*
+    | Adds base to the target words of each half of the board and compresses the lanes whose |
+    | target bit is set into the move list, so a bitboard of moves costs a compress and a    |
+    | store per half instead of a loop over its bits. Lane order matches pop_bit order.      |
+    */
+    __attribute__((target("avx512f,avx512bw,avx512vbmi2"))) void
+    emit_moves_avx512(MoveList &moves, Bitboard targets, const Move_T *words, Move_T base) {
+        assert(moves.size() + std::popcount(targets) <= MAX_MOVES);
+        const __m512i offset = _mm512_set1_epi16(static_cast<short>(base));
+        Move_T *out          = reinterpret_cast<Move_T *>(moves.data() + moves.size());
+        for (int half = 0; half < 2; half++) {
+            const __mmask32 mask = static_cast<__mmask32>(targets >> (32 * half));
+            if (! mask)
+                continue;
+            const __m512i lanes = _mm512_add_epi16(_mm512_load_si512(words + 32 * half), offset);
+            // A full unmasked store is cheaper than a compress to memory, when the list has room
+            if (out + 32 <= reinterpret_cast<Move_T *>(moves.data() + MAX_MOVES))
+                _mm512_storeu_si512(out, _mm512_maskz_compress_epi16(mask, lanes));
+            else
+                _mm512_mask_compressstoreu_epi16(out, mask, lanes);
+            out += std::popcount(mask);
+        }
+        moves.resize(moves.size() + std::popcount(targets));
+    }
+#endif
+
+    // Pushes one move per bit of targets; base holds everything but the target square
+    template <bool pawn> void emit_moves(MoveList &moves, Bitboard targets, Move_T base) {
+        constexpr const std::array<Move_T, 64> &words =
+            pawn ? pawn_target_words : piece_target_words;
+#ifdef MOVEGEN_AVX512
+        // A lone target is cheaper to push directly than to set up the vectors for
+        if (use_avx512 && std::popcount(targets) > 1) {
+            emit_moves_avx512(moves, targets, words.data(), base);
+            return;
+        }
+#endif
+        move::Move m;
+        while (targets) {
+            m.set_move(static_cast<Move_T>(base + words[bits::pop_bit(targets)]));
+            moves.push(m);
+        }
+    }
+
+    constexpr Move_T pawn_base(move::Flag flag, int offset) {
+        return static_cast<Move_T>((static_cast<int>(flag) << 12) - offset);
+    }
 
-        Bitboard our_rank_3     = side == Color::WHITE ? Rank_3_BB : Rank_6_BB;
-        Bitboard our_rank_7     = side == Color::WHITE ? Rank_7_BB : Rank_2_BB;
-        Bitboard not_our_rank_7 = ~our_rank_7;
+    constexpr Move_T piece_base(move::Flag flag, Square source) {
+        return static_cast<Move_T>(static_cast<int>(flag) << 12 | static_cast<int>(source));
+    }
 
-        int push    = side == Color::WHITE ? 8 : -8;
-        int diag_0  = side == Color::WHITE ? 9 : -7;
-        int diag_1  = side == Color::WHITE ? 7 : -9;
-        Piece piece = side == Color::WHITE ? Piece::wP : Piece::bP;
+    /*
+    | Every generator is a template on the side to move, so push directions, home ranks, piece  |
+    | sets and castling squares are constants. The side is looked at once per call, in the      |
+    | public entry points at the bottom of this file.                                           |
+    */
+    template <Color side, bool noisy>
+    void generate_pawn_moves(const Board &board, MoveList &moves) {
+        constexpr Color enemy_side = side == Color::WHITE ? Color::BLACK : Color::WHITE;
+        Bitboard pawns             = board.pawns<side>();
+
+        constexpr Bitboard our_rank_3     = side == Color::WHITE ? Rank_3_BB : Rank_6_BB;
+        constexpr Bitboard our_rank_7     = side == Color::WHITE ? Rank_7_BB : Rank_2_BB;
+        constexpr Bitboard not_our_rank_7 = ~our_rank_7;
+
+        constexpr int push   = side == Color::WHITE ? 8 : -8;
+        constexpr int diag_0 = side == Color::WHITE ? 9 : -7;
+        constexpr int diag_1 = side == Color::WHITE ? 7 : -9;
 
         move::Move m;
 
-        if (! noisy) {
+        if constexpr (! noisy) {
             Bitboard push_1 = sh_l((pawns & not_our_rank_7), push) & ~board.occupancy();
             Bitboard push_2 = sh_l((push_1 & our_rank_3), push) & ~board.occupancy();
-            while (push_1) {
-                int to = bits::pop_bit(push_1);
-                m.set_move(static_cast<Square>(to - push), static_cast<Square>(to), piece,
-                           move::Flag::NORMAL, move::Promotion::QUEEN);
-                moves.push(m);
-            }
-
-            while (push_2) {
-                int to = bits::pop_bit(push_2);
-                m.set_move(static_cast<Square>(to - 2 * push), static_cast<Square>(to), piece,
-                           move::Flag::DOUBLE_PAWN_PUSH, move::Promotion::QUEEN);
-                moves.push(m);
-            }
+            emit_moves<true>(moves, push_1, pawn_base(move::Flag::NORMAL, push));
+            emit_moves<true>(moves, push_2, pawn_base(move::Flag::DOUBLE_PAWN_PUSH, 2 * push));
         }
 
-        Bitboard capture_0 =
-            sh_l((pawns & not_our_rank_7 & not_h_file), diag_0) & board.color_occupancy(stm ^ 1);
-        Bitboard capture_1 =
-            sh_l((pawns & not_our_rank_7 & not_a_file), diag_1) & board.color_occupancy(stm ^ 1);
-
-        if (noisy) {
-            while (capture_0) {
-                int to = bits::pop_bit(capture_0);
-                m.set_move(static_cast<Square>(to - diag_0), static_cast<Square>(to), piece,
-                           move::Flag::CAPTURE, move::Promotion::QUEEN);
-                moves.push(m);
-            }
+        if constexpr (noisy) {
+            Bitboard capture_0 = sh_l((pawns & not_our_rank_7 & not_h_file), diag_0) &
+                                 board.color_occupancy(enemy_side);
+            Bitboard capture_1 = sh_l((pawns & not_our_rank_7 & not_a_file), diag_1) &
+                                 board.color_occupancy(enemy_side);
 
-            while (capture_1) {
-                int to = bits::pop_bit(capture_1);
-                m.set_move(static_cast<Square>(to - diag_1), static_cast<Square>(to), piece,
-                           move::Flag::CAPTURE, move::Promotion::QUEEN);
-                moves.push(m);
-            }
+            emit_moves<true>(moves, capture_0, pawn_base(move::Flag::CAPTURE, diag_0));
+            emit_moves<true>(moves, capture_1, pawn_base(move::Flag::CAPTURE, diag_1));
 
             if (board.get_en_passant_square() != Square::NO_SQ) {
                 Bitboard ep_pawns =
-                    pawns & attacks::get_pawn_attacks(static_cast<Color>(stm ^ 1),
-                                                      board.get_en_passant_square());
+                    pawns & attacks::get_pawn_attacks(enemy_side, board.get_en_passant_square());
                 while (ep_pawns) {
                     int from = bits::pop_bit(ep_pawns);
-                    m.set_move(static_cast<Square>(from), board.get_en_passant_square(), piece,
+                    m.set_move(static_cast<Square>(from), board.get_en_passant_square(),
                                move::Flag::EN_PASSANT, move::Promotion::QUEEN);
                     moves.push(m);
                 }
@@ -79,377 +146,354 @@ namespace elixir::movegen {
         }
 
         Bitboard promotion = sh_l((pawns & our_rank_7), push) & ~board.occupancy();
-        Bitboard promotion_capture_0 =
-            sh_l((pawns & our_rank_7 & not_h_file), diag_0) & board.color_occupancy(stm ^ 1);
-        Bitboard promotion_capture_1 =
-            sh_l((pawns & our_rank_7 & not_a_file), diag_1) & board.color_occupancy(stm ^ 1);
 
         while (promotion) {
             int to = bits::pop_bit(promotion);
-            if (noisy) {
-                m.set_move(static_cast<Square>(to - push), static_cast<Square>(to), piece,
+            if constexpr (noisy) {
+                m.set_move(static_cast<Square>(to - push), static_cast<Square>(to),
                            move::Flag::PROMOTION, move::Promotion::QUEEN);
                 moves.push(m);
             } else {
-                m.set_move(static_cast<Square>(to - push), static_cast<Square>(to), piece,
+                m.set_move(static_cast<Square>(to - push), static_cast<Square>(to),
                            move::Flag::PROMOTION, move::Promotion::ROOK);
                 moves.push(m);
-                m.set_move(static_cast<Square>(to - push), static_cast<Square>(to), piece,
+                m.set_move(static_cast<Square>(to - push), static_cast<Square>(to),
                            move::Flag::PROMOTION, move::Promotion::BISHOP);
                 moves.push(m);
-                m.set_move(static_cast<Square>(to - push), static_cast<Square>(to), piece,
+                m.set_move(static_cast<Square>(to - push), static_cast<Square>(to),
                            move::Flag::PROMOTION, move::Promotion::KNIGHT);
                 moves.push(m);
             }
         }
 
-        if (noisy) {
+        if constexpr (noisy) {
+            Bitboard promotion_capture_0 = sh_l((pawns & our_rank_7 & not_h_file), diag_0) &
+                                           board.color_occupancy(enemy_side);
+            Bitboard promotion_capture_1 = sh_l((pawns & our_rank_7 & not_a_file), diag_1) &
+                                           board.color_occupancy(enemy_side);
+
             while (promotion_capture_0) {
                 int to = bits::pop_bit(promotion_capture_0);
-                m.set_move(static_cast<Square>(to - diag_0), static_cast<Square>(to), piece,
+                m.set_move(static_cast<Square>(to - diag_0), static_cast<Square>(to),
                            move::Flag::CAPTURE_PROMOTION, move::Promotion::QUEEN);
                 moves.push(m);
-                m.set_move(static_cast<Square>(to - diag_0), static_cast<Square>(to), piece,
+                m.set_move(static_cast<Square>(to - diag_0), static_cast<Square>(to),
                            move::Flag::CAPTURE_PROMOTION, move::Promotion::ROOK);
                 moves.push(m);
-                m.set_move(static_cast<Square>(to - diag_0), static_cast<Square>(to), piece,
+                m.set_move(static_cast<Square>(to - diag_0), static_cast<Square>(to),
                            move::Flag::CAPTURE_PROMOTION, move::Promotion::BISHOP);
                 moves.push(m);
-                m.set_move(static_cast<Square>(to - diag_0), static_cast<Square>(to), piece,
+                m.set_move(static_cast<Square>(to - diag_0), static_cast<Square>(to),
                            move::Flag::CAPTURE_PROMOTION, move::Promotion::KNIGHT);
                 moves.push(m);
             }
 
             while (promotion_capture_1) {
                 int to = bits::pop_bit(promotion_capture_1);
-                m.set_move(static_cast<Square>(to - diag_1), static_cast<Square>(to), piece,
+                m.set_move(static_cast<Square>(to - diag_1), static_cast<Square>(to),
                            move::Flag::CAPTURE_PROMOTION, move::Promotion::QUEEN);
                 moves.push(m);
-                m.set_move(static_cast<Square>(to - diag_1), static_cast<Square>(to), piece,
+                m.set_move(static_cast<Square>(to - diag_1), static_cast<Square>(to),
                            move::Flag::CAPTURE_PROMOTION, move::Promotion::ROOK);
                 moves.push(m);
-                m.set_move(static_cast<Square>(to - diag_1), static_cast<Square>(to), piece,
+                m.set_move(static_cast<Square>(to - diag_1), static_cast<Square>(to),
                            move::Flag::CAPTURE_PROMOTION, move::Promotion::BISHOP);
                 moves.push(m);
-                m.set_move(static_cast<Square>(to - diag_1), static_cast<Square>(to), piece,
+                m.set_move(static_cast<Square>(to - diag_1), static_cast<Square>(to),
                            move::Flag::CAPTURE_PROMOTION, move::Promotion::KNIGHT);
                 moves.push(m);
             }
         }
     }
 
-    void generate_castling_moves(const Board &board, MoveList &moves) {
-        Bitboard king;
-        Bitboard occupancy = board.occupancy();
-        Color side         = board.get_side_to_move();
-        I8 stm             = static_cast<int>(side);
-        I8 xstm            = stm ^ 1;
-        Color enemy_side   = static_cast<Color>(xstm);
-        Piece piece;
+    template <Color side> void generate_castling_moves(const Board &board, MoveList &moves) {
+        constexpr Color enemy_side = side == Color::WHITE ? Color::BLACK : Color::WHITE;
+        constexpr Castling kingside =
+            side == Color::WHITE ? CASTLE_WHITE_KINGSIDE : CASTLE_BLACK_KINGSIDE;
+        constexpr Castling queenside =
+            side == Color::WHITE ? CASTLE_WHITE_QUEENSIDE : CASTLE_BLACK_QUEENSIDE;
+
+        constexpr Square e = side == Color::WHITE ? Square::E1 : Square::E8;
+        constexpr Square f = side == Color::WHITE ? Square::F1 : Square::F8;
+        constexpr Square g = side == Color::WHITE ? Square::G1 : Square::G8;
+        constexpr Square d = side == Color::WHITE ? Square::D1 : Square::D8;
+        constexpr Square c = side == Color::WHITE ? Square::C1 : Square::C8;
+        constexpr Square b = side == Color::WHITE ? Square::B1 : Square::B8;
+
+        Bitboard occupancy       = board.occupancy();
         Castling caslting_rights = board.get_castling_rights();
 
-        switch (side) {
-            case Color::WHITE:
-                king  = board.king<Color::WHITE>();
-                piece = Piece::wK;
-                if (caslting_rights & CASTLE_WHITE_KINGSIDE) {
-                    if (! bits::get_bit(occupancy, Square::F1) &&
-                        ! bits::get_bit(occupancy, Square::G1)) {
-                        if (! board.is_square_attacked(Square::E1, enemy_side) &&
-                            ! board.is_square_attacked(Square::F1, enemy_side)) {
-                            move::Move m;
-                            m.set_move(Square::E1, Square::G1, piece, move::Flag::CASTLING,
-                                       move::Promotion::QUEEN);
-                            moves.push(m);
-                        }
-                    }
-                }
-                if (caslting_rights & CASTLE_WHITE_QUEENSIDE) {
-                    if (! bits::get_bit(occupancy, Square::D1) &&
-                        ! bits::get_bit(occupancy, Square::C1) &&
-                        ! bits::get_bit(occupancy, Square::B1)) {
-                        if (! board.is_square_attacked(Square::E1, enemy_side) &&
-                            ! board.is_square_attacked(Square::D1, enemy_side)) {
-                            move::Move m;
-                            m.set_move(Square::E1, Square::C1, piece, move::Flag::CASTLING,
-                                       move::Promotion::QUEEN);
-                            moves.push(m);
-                        }
-                    }
-                }
-                break;
-            case Color::BLACK:
-                king  = board.king<Color::BLACK>();
-                piece = Piece::bK;
-                if (caslting_rights & CASTLE_BLACK_KINGSIDE) {
-                    if (! bits::get_bit(occupancy, Square::F8) &&
-                        ! bits::get_bit(occupancy, Square::G8)) {
-                        if (! board.is_square_attacked(Square::E8, enemy_side) &&
-                            ! board.is_square_attacked(Square::F8, enemy_side)) {
-                            move::Move m;
-                            m.set_move(Square::E8, Square::G8, piece, move::Flag::CASTLING,
-                                       move::Promotion::QUEEN);
-                            moves.push(m);
-                        }
-                    }
+        if (caslting_rights & kingside) {
+            if (! bits::get_bit(occupancy, f) && ! bits::get_bit(occupancy, g)) {
+                if (! board.is_square_attacked(e, enemy_side) &&
+                    ! board.is_square_attacked(f, enemy_side)) {
+                    move::Move m;
+                    m.set_move(e, g, move::Flag::CASTLING, move::Promotion::QUEEN);
+                    moves.push(m);
                 }
-                if (caslting_rights & CASTLE_BLACK_QUEENSIDE) {
-                    if (! bits::get_bit(occupancy, Square::D8) &&
-                        ! bits::get_bit(occupancy, Square::C8) &&
-                        ! bits::get_bit(occupancy, Square::B8)) {
-                        if (! board.is_square_attacked(Square::E8, enemy_side) &&
-                            ! board.is_square_attacked(Square::D8, enemy_side)) {
-                            move::Move m;
-                            m.set_move(Square::E8, Square::C8, piece, move::Flag::CASTLING,
-                                       move::Promotion::QUEEN);
-                            moves.push(m);
-                        }
-                    }
+            }
+        }
+        if (caslting_rights & queenside) {
+            if (! bits::get_bit(occupancy, d) && ! bits::get_bit(occupancy, c) &&
+                ! bits::get_bit(occupancy, b)) {
+                if (! board.is_square_attacked(e, enemy_side) &&
+                    ! board.is_square_attacked(d, enemy_side)) {
+                    move::Move m;
+                    m.set_move(e, c, move::Flag::CASTLING, move::Promotion::QUEEN);
+                    moves.push(m);
                 }
-                break;
-            default:
-                assert(false);
-                break;
+            }
         }
     }
 
-    template <bool noisy> void generate_knight_moves(const Board &board, MoveList &moves) {
-        Bitboard knights = 0ULL;
-        Color enemy_side;
-        Piece piece;
-        Color side = board.get_side_to_move();
-        switch (side) {
-            case Color::WHITE:
-                knights    = board.knights<Color::WHITE>();
-                piece      = Piece::wN;
-                enemy_side = Color::BLACK;
-                break;
-            case Color::BLACK:
-                knights    = board.knights<Color::BLACK>();
-                piece      = Piece::bN;
-                enemy_side = Color::WHITE;
-                break;
-            default:
-                assert(false);
-                break;
-        }
+    // Emits the moves of one piece from source to the squares in attacks
+    template <Color side, bool noisy>
+    void generate_targets(const Board &board, MoveList &moves, Square source, Bitboard attacks) {
+        constexpr Color enemy_side = side == Color::WHITE ? Color::BLACK : Color::WHITE;
+        constexpr move::Flag flag  = noisy ? move::Flag::CAPTURE : move::Flag::NORMAL;
+        attacks &= noisy ? board.color_occupancy(enemy_side) : ~board.occupancy();
+        emit_moves<false>(moves, attacks, piece_base(flag, source));
+    }
+
+    template <Color side, bool noisy>
+    void generate_knight_moves(const Board &board, MoveList &moves) {
+        Bitboard knights = board.knights<side>();
         while (knights) {
-            move::Move m;
-            Square source    = static_cast<Square>(bits::pop_bit(knights));
-            Bitboard attacks = attacks::get_knight_attacks(source) & ~board.color_occupancy(side);
-            while (attacks) {
-                Square target = static_cast<Square>(bits::pop_bit(attacks));
-                if (! bits::get_bit(board.color_occupancy(enemy_side), target)) {
-                    if (noisy)
-                        continue;
-                    m.set_move(source, target, piece, move::Flag::NORMAL, move::Promotion::QUEEN);
-                } else {
-                    if (! noisy)
-                        continue;
-                    m.set_move(source, target, piece, move::Flag::CAPTURE, move::Promotion::QUEEN);
-                }
-                moves.push(m);
-            }
+            Square source = static_cast<Square>(bits::pop_bit(knights));
+            generate_targets<side, noisy>(board, moves, source,
+                                          attacks::get_knight_attacks(source));
         }
     }
 
-    template <bool noisy> void generate_bishop_moves(const Board &board, MoveList &moves) {
-        Bitboard bishops;
-        Piece piece;
-        Color enemy_side;
-        Color side = board.get_side_to_move();
-        switch (side) {
-            case Color::WHITE:
-                bishops    = board.bishops<Color::WHITE>();
-                piece      = Piece::wB;
-                enemy_side = Color::BLACK;
-                break;
-            case Color::BLACK:
-                bishops    = board.bishops<Color::BLACK>();
-                piece      = Piece::bB;
-                enemy_side = Color::WHITE;
-                break;
-            default:
-                assert(false);
-                break;
-        }
+    template <Color side, bool noisy>
+    void generate_bishop_moves(const Board &board, MoveList &moves) {
+        Bitboard bishops = board.bishops<side>();
         while (bishops) {
-            move::Move m;
-            Square source    = static_cast<Square>(bits::pop_bit(bishops));
-            Bitboard attacks = attacks::get_bishop_attacks(source, board.occupancy()) &
-                               ~board.color_occupancy(side);
-            while (attacks) {
-                Square target = static_cast<Square>(bits::pop_bit(attacks));
-                if (! bits::get_bit(board.color_occupancy(enemy_side), target)) {
-                    if (noisy)
-                        continue;
-                    m.set_move(source, target, piece, move::Flag::NORMAL, move::Promotion::QUEEN);
-                } else {
-                    if (! noisy)
-                        continue;
-                    m.set_move(source, target, piece, move::Flag::CAPTURE, move::Promotion::QUEEN);
-                }
-                moves.push(m);
-            }
+            Square source = static_cast<Square>(bits::pop_bit(bishops));
+            generate_targets<side, noisy>(board, moves, source,
+                                          attacks::get_bishop_attacks(source, board.occupancy()));
         }
     }
 
-    template <bool noisy> void generate_rook_moves(const Board &board, MoveList &moves) {
-        Bitboard rooks;
-        Piece piece;
-        Color enemy_side;
-        Color side = board.get_side_to_move();
-        switch (side) {
-            case Color::WHITE:
-                rooks      = board.rooks<Color::WHITE>();
-                piece      = Piece::wR;
-                enemy_side = Color::BLACK;
-                break;
-            case Color::BLACK:
-                rooks      = board.rooks<Color::BLACK>();
-                piece      = Piece::bR;
-                enemy_side = Color::WHITE;
-                break;
-            default:
-                assert(false);
-                break;
-        }
+    template <Color side, bool noisy>
+    void generate_rook_moves(const Board &board, MoveList &moves) {
+        Bitboard rooks = board.rooks<side>();
         while (rooks) {
-            move::Move m;
             Square source = static_cast<Square>(bits::pop_bit(rooks));
-            Bitboard attacks =
-                attacks::get_rook_attacks(source, board.occupancy()) & ~board.color_occupancy(side);
-            while (attacks) {
-                Square target = static_cast<Square>(bits::pop_bit(attacks));
-                if (! bits::get_bit(board.color_occupancy(enemy_side), target)) {
-                    if (noisy)
-                        continue;
-                    m.set_move(source, target, piece, move::Flag::NORMAL, move::Promotion::QUEEN);
-                } else {
-                    if (! noisy)
-                        continue;
-                    m.set_move(source, target, piece, move::Flag::CAPTURE, move::Promotion::QUEEN);
-                }
-                moves.push(m);
-            }
+            generate_targets<side, noisy>(board, moves, source,
+                                          attacks::get_rook_attacks(source, board.occupancy()));
+        }
+    }
+
+    template <Color side, bool noisy>
+    void generate_queen_moves(const Board &board, MoveList &moves) {
+        Bitboard queens = board.queens<side>();
+        while (queens) {
+            Square source = static_cast<Square>(bits::pop_bit(queens));
+            generate_targets<side, noisy>(board, moves, source,
+                                          attacks::get_queen_attacks(source, board.occupancy()));
         }
     }
 
-    template <bool noisy> void generate_queen_moves(const Board &board, MoveList &moves) {
-        Bitboard queens;
-        Piece piece;
-        Color enemy_side;
-        Color side = board.get_side_to_move();
-        switch (side) {
-            case Color::WHITE:
-                queens     = board.queens<Color::WHITE>();
-                piece      = Piece::wQ;
-                enemy_side = Color::BLACK;
-                break;
-            case Color::BLACK:
-                queens     = board.queens<Color::BLACK>();
-                piece      = Piece::bQ;
-                enemy_side = Color::WHITE;
-                break;
+    template <Color side, bool noisy>
+    void generate_king_moves(const Board &board, MoveList &moves) {
+        Bitboard kings = board.king<side>();
+        while (kings) {
+            Square source = static_cast<Square>(bits::pop_bit(kings));
+            generate_targets<side, noisy>(board, moves, source, attacks::get_king_attacks(source));
+        }
+    }
+
+    template <Color side> void generate_noisy_moves(const Board &board, MoveList &moves) {
+        generate_pawn_moves<side, true>(board, moves);
+        generate_knight_moves<side, true>(board, moves);
+        generate_bishop_moves<side, true>(board, moves);
+        generate_rook_moves<side, true>(board, moves);
+        generate_queen_moves<side, true>(board, moves);
+        generate_king_moves<side, true>(board, moves);
+    }
+
+    template <Color side> void generate_quiet_moves(const Board &board, MoveList &moves) {
+        generate_pawn_moves<side, false>(board, moves);
+        generate_castling_moves<side>(board, moves);
+        generate_knight_moves<side, false>(board, moves);
+        generate_bishop_moves<side, false>(board, moves);
+        generate_rook_moves<side, false>(board, moves);
+        generate_queen_moves<side, false>(board, moves);
+        generate_king_moves<side, false>(board, moves);
+    }
+
+    Bitboard attacks_to(PieceType piece, Color enemy_side, Square sq, Bitboard occupancy) {
+        switch (piece) {
+            case PieceType::PAWN:
+                return attacks::get_pawn_attacks(enemy_side, sq);
+            case PieceType::KNIGHT:
+                return attacks::get_knight_attacks(sq);
+            case PieceType::BISHOP:
+                return attacks::get_bishop_attacks(sq, occupancy);
+            case PieceType::ROOK:
+                return attacks::get_rook_attacks(sq, occupancy);
+            case PieceType::QUEEN:
+                return attacks::get_queen_attacks(sq, occupancy);
+            case PieceType::KING:
+                return attacks::get_king_attacks(sq);
             default:
                 assert(false);
-                break;
+                return 0ULL;
         }
-        while (queens) {
-            move::Move m;
-            Square source    = static_cast<Square>(bits::pop_bit(queens));
-            Bitboard attacks = attacks::get_queen_attacks(source, board.occupancy()) &
-                               ~board.color_occupancy(side);
-            while (attacks) {
-                Square target = static_cast<Square>(bits::pop_bit(attacks));
-                if (! bits::get_bit(board.color_occupancy(enemy_side), target)) {
-                    if (noisy)
-                        continue;
-                    m.set_move(source, target, piece, move::Flag::NORMAL, move::Promotion::QUEEN);
-                } else {
-                    if (! noisy)
-                        continue;
-                    m.set_move(source, target, piece, move::Flag::CAPTURE, move::Promotion::QUEEN);
+    }
+
+    template <Color side>
+    void generate_capture_promotions(const Board &board, MoveList &moves, Bitboard promoting,
+                                     move::Promotion promotion) {
+        constexpr Color enemy_side = side == Color::WHITE ? Color::BLACK : Color::WHITE;
+        move::Move m;
+        for (int victim = static_cast<int>(PieceType::QUEEN);
+             victim >= static_cast<int>(PieceType::KNIGHT); victim--) {
+            Bitboard targets = board.piece_bitboard(static_cast<PieceType>(victim)) &
+                               board.color_occupancy(enemy_side);
+            while (targets) {
+                Square target    = static_cast<Square>(bits::pop_bit(targets));
+                Bitboard sources = attacks::get_pawn_attacks(enemy_side, target) & promoting;
+                while (sources) {
+                    Square source = static_cast<Square>(bits::pop_bit(sources));
+                    m.set_move(source, target, move::Flag::CAPTURE_PROMOTION, promotion);
+                    moves.push(m);
                 }
-                moves.push(m);
             }
         }
     }
 
-    template <bool noisy> void generate_king_moves(const Board &board, MoveList &moves) {
-        Bitboard kings;
-        Piece piece;
-        Color enemy_side;
-        Color side = board.get_side_to_move();
-        switch (side) {
-            case Color::WHITE:
-                kings      = board.king<Color::WHITE>();
-                piece      = Piece::wK;
-                enemy_side = Color::BLACK;
-                break;
-            case Color::BLACK:
-                kings      = board.king<Color::BLACK>();
-                piece      = Piece::bK;
-                enemy_side = Color::WHITE;
-                break;
-            default:
-                assert(false);
-                break;
+    /*
+    | The noisy moves of generate_moves<true>, emitted in the order qsearch tries them: queen |
+    | and knight promotions, then captures from the most valuable victim down and the least   |
+    | valuable attacker up, then the rook and bishop underpromotions. The picker hands them   |
+    | out as they are, with no scoring pass.                                                  |
+    */
+    template <Color side> void generate_qs_moves(const Board &board, MoveList &moves) {
+        constexpr Color enemy_side    = side == Color::WHITE ? Color::BLACK : Color::WHITE;
+        constexpr Bitboard our_rank_7 = side == Color::WHITE ? Rank_7_BB : Rank_2_BB;
+        constexpr int push            = side == Color::WHITE ? 8 : -8;
+
+        Bitboard us        = board.color_occupancy(side);
+        Bitboard them      = board.color_occupancy(enemy_side);
+        Bitboard occupancy = us | them;
+        Bitboard promoting = board.pawns<side>() & our_rank_7;
+
+        move::Move m;
+
+        generate_capture_promotions<side>(board, moves, promoting, move::Promotion::QUEEN);
+        Bitboard promotion = sh_l(promoting, push) & ~occupancy;
+        while (promotion) {
+            int to = bits::pop_bit(promotion);
+            m.set_move(static_cast<Square>(to - push), static_cast<Square>(to),
+                       move::Flag::PROMOTION, move::Promotion::QUEEN);
+            moves.push(m);
         }
-        while (kings) {
-            move::Move m;
-            Square source    = static_cast<Square>(bits::pop_bit(kings));
-            Bitboard attacks = attacks::get_king_attacks(source) & ~board.color_occupancy(side);
-            while (attacks) {
-                Square target = static_cast<Square>(bits::pop_bit(attacks));
-                if (! bits::get_bit(board.color_occupancy(enemy_side), target)) {
-                    if (noisy)
-                        continue;
-                    m.set_move(source, target, piece, move::Flag::NORMAL, move::Promotion::QUEEN);
-                } else {
-                    if (! noisy)
-                        continue;
-                    m.set_move(source, target, piece, move::Flag::CAPTURE, move::Promotion::QUEEN);
+        generate_capture_promotions<side>(board, moves, promoting, move::Promotion::KNIGHT);
+
+        /*
+        | The enemy pieces each piece type can take are gathered first, so a victim and attacker |
+        | pair with no capture between them costs a single test.                                 |
+        */
+        Bitboard attackers[6], targets[6];
+        for (int attacker = static_cast<int>(PieceType::PAWN);
+             attacker <= static_cast<int>(PieceType::KING); attacker++) {
+            PieceType piece     = static_cast<PieceType>(attacker);
+            attackers[attacker] = board.piece_bitboard(piece) & us;
+            targets[attacker]   = 0ULL;
+
+            if (piece == PieceType::PAWN) {
+                // Pawns on the seventh only capture by promoting
+                attackers[attacker] &= ~our_rank_7;
+                targets[attacker] = sh_l(attackers[attacker] & not_h_file, push + 1) |
+                                    sh_l(attackers[attacker] & not_a_file, push - 1);
+            } else {
+                Bitboard sources = attackers[attacker];
+                while (sources) {
+                    Square source = static_cast<Square>(bits::pop_bit(sources));
+                    targets[attacker] |= attacks_to(piece, side, source, occupancy);
+                }
+            }
+            targets[attacker] &= them;
+        }
+
+        for (int victim = static_cast<int>(PieceType::QUEEN);
+             victim >= static_cast<int>(PieceType::PAWN); victim--) {
+            Bitboard victims = board.piece_bitboard(static_cast<PieceType>(victim)) & them;
+            for (int attacker = static_cast<int>(PieceType::PAWN);
+                 attacker <= static_cast<int>(PieceType::KING); attacker++) {
+                PieceType piece = static_cast<PieceType>(attacker);
+
+                Bitboard targets_hit = victims & targets[attacker];
+                while (targets_hit) {
+                    Square target = static_cast<Square>(bits::pop_bit(targets_hit));
+                    Bitboard sources =
+                        attacks_to(piece, enemy_side, target, occupancy) & attackers[attacker];
+                    while (sources) {
+                        Square source = static_cast<Square>(bits::pop_bit(sources));
+                        m.set_move(source, target, move::Flag::CAPTURE, move::Promotion::QUEEN);
+                        moves.push(m);
+                    }
+                }
+
+                if (piece == PieceType::PAWN && victim == static_cast<int>(PieceType::PAWN) &&
+                    board.get_en_passant_square() != Square::NO_SQ) {
+                    Bitboard sources =
+                        attacks::get_pawn_attacks(enemy_side, board.get_en_passant_square()) &
+                        attackers[attacker];
+                    while (sources) {
+                        Square source = static_cast<Square>(bits::pop_bit(sources));
+                        m.set_move(source, board.get_en_passant_square(), move::Flag::EN_PASSANT,
+                                   move::Promotion::QUEEN);
+                        moves.push(m);
+                    }
                 }
-                moves.push(m);
             }
         }
+
+        generate_capture_promotions<side>(board, moves, promoting, move::Promotion::BISHOP);
+        generate_capture_promotions<side>(board, moves, promoting, move::Promotion::ROOK);
     }
 
+
     void generate_noisy_moves(const Board &board, MoveList &moves) {
-        generate_pawn_moves<true>(board, moves);
-        generate_knight_moves<true>(board, moves);
-        generate_bishop_moves<true>(board, moves);
-        generate_rook_moves<true>(board, moves);
-        generate_queen_moves<true>(board, moves);
-        generate_king_moves<true>(board, moves);
+        if (board.get_side_to_move() == Color::WHITE)
+            generate_noisy_moves<Color::WHITE>(board, moves);
+        else
+            generate_noisy_moves<Color::BLACK>(board, moves);
     }
 
     void generate_quiet_moves(const Board &board, MoveList &moves) {
-        generate_pawn_moves<false>(board, moves);
-        generate_castling_moves(board, moves);
-        generate_knight_moves<false>(board, moves);
-        generate_bishop_moves<false>(board, moves);
-        generate_rook_moves<false>(board, moves);
-        generate_queen_moves<false>(board, moves);
-        generate_king_moves<false>(board, moves);
+        if (board.get_side_to_move() == Color::WHITE)
+            generate_quiet_moves<Color::WHITE>(board, moves);
+        else
+            generate_quiet_moves<Color::BLACK>(board, moves);
     }
 
+    void generate_qs_moves(const Board &board, MoveList &moves) {
+        moves.clear();
+        if (board.get_side_to_move() == Color::WHITE)
+            generate_qs_moves<Color::WHITE>(board, moves);
+        else
+            generate_qs_moves<Color::BLACK>(board, moves);
+    }
 
-    template <bool noisy> MoveList generate_moves(const Board &board) {
-        MoveList moves;
-
-        if (noisy) {
-            generate_noisy_moves(board, moves);
-        } else {
-            generate_noisy_moves(board, moves);
-            generate_quiet_moves(board, moves);
-        }
+    template <Color side, bool noisy> void generate_all_moves(const Board &board, MoveList &moves) {
+        generate_noisy_moves<side>(board, moves);
+        if constexpr (! noisy)
+            generate_quiet_moves<side>(board, moves);
+    }
 
-        return moves;
+    template <bool noisy> void generate_moves(const Board &board, MoveList &moves) {
+        moves.clear();
+        if (board.get_side_to_move() == Color::WHITE)
+            generate_all_moves<Color::WHITE, noisy>(board, moves);
+        else
+            generate_all_moves<Color::BLACK, noisy>(board, moves);
     }
 
     // forward declaration of move generator
-    template MoveList generate_moves<true>(const Board &board);
-    template MoveList generate_moves<false>(const Board &board);
+    template void generate_moves<true>(const Board &board, MoveList &moves);
+    template void generate_moves<false>(const Board &board, MoveList &moves);
 }
\ No newline at end of file
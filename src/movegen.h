@@ -10,14 +10,22 @@
 
 namespace elixir::movegen {
     constexpr int MAX_MOVES = 256;
+
+    // Set once at startup when the CPU can emit moves with AVX-512 compress-stores
+    extern bool use_avx512;
+    void init_movegen();
+
     constexpr Bitboard sh_l(const Bitboard &b, int n) {
         if (n > 0)
             return b << n;
         else
             return b >> -n;
     }
-    template <bool noisy> MoveList generate_moves(const Board &board);
+    // Replaces the contents of moves with the pseudo-legal moves of the position
+    template <bool noisy> void generate_moves(const Board &board, MoveList &moves);
 
+    // Replaces the contents of moves with the noisy moves of the position in qsearch order
+    void generate_qs_moves(const Board &board, MoveList &moves);
     void generate_noisy_moves(const Board &board, MoveList &moves);
     void generate_quiet_moves(const Board &board, MoveList &moves);
 }
\ No newline at end of file
@@ -1,7 +1,9 @@
+#include <algorithm>
 #include <climits>
 #include <iostream>
 
 #include "evaluate.h"
+#include "history.h"
 #include "move.h"
 #include "movegen.h"
 #include "movepicker.h"
@@ -9,23 +11,30 @@
 
 namespace elixir {
 
-    int MP_SEE = 109;
+    int MP_SEE                     = 109;
+    int MP_CAPTURE_HISTORY_DIVISOR = 32;
 
     void MovePicker::score_moves(const Board &board, const move::Move &tt_move,
                                  const search::SearchStack *ss) {
         scores.resize(moves.size());
+        see_values.resize(moves.size());
+        see_context.init(board);
 
         int value;
         Square from, to;
 
+        const move::Move counter_move = history->get_counter_move((ss - 1)->piece, (ss - 1)->move);
+
         for (int i = 0; i < moves.size(); i++) {
 
             move::Move move = moves[i];
 
-            value = 0;
+            value         = 0;
+            see_values[i] = SEE_UNKNOWN;
 
-            from = move.get_from();
-            to   = move.get_to();
+            from        = move.get_from();
+            to          = move.get_to();
+            Piece piece = board.piece_on(from);
 
             // TT Move Ordering(~180 ELO)
             if (move == tt_move) {
@@ -51,18 +60,27 @@ namespace elixir {
                 }
             } else if (move.is_capture() || move.is_en_passant()) {
                 auto captured_piece =
-                    move.is_en_passant()
-                        ? static_cast<int>(PieceType::PAWN)
-                        : static_cast<int>(board.piece_to_piecetype(board.piece_on(to)));
-                value = eval::piece_values[captured_piece];
-                value += search::SEE(board, move, -MP_SEE) ? 1000000000 : -1000000;
+                    move.is_en_passant() ? PieceType::PAWN
+                                         : board.piece_to_piecetype(board.piece_on(to));
+                // Capture History Move Ordering
+                value = eval::piece_values[static_cast<int>(captured_piece)] +
+                        history->get_capture_history(piece, move, captured_piece) /
+                            MP_CAPTURE_HISTORY_DIVISOR;
+                see_values[i] = see_context.value(move);
+                value += see_values[i] >= -MP_SEE ? 1000000000 : -1000000;
             } else if (move == ss->killers[0]) {
                 value = 800000000;
             } else if (move == ss->killers[1]) {
                 value = 700000000;
+            } else if (move == counter_move) {
+                value = 600000000;
             } else {
-                // Butterfly History Move Ordering (~45 ELO)
-                value = board.history.get_history(from, to);
+                // Butterfly (~45 ELO) and 1-ply / 2-ply Continuation History Move Ordering
+                value = history->get_history(board.get_side_to_move(), from, to) +
+                        history->get_continuation_history((ss - 1)->piece, (ss - 1)->move, piece,
+                                                          move) +
+                        history->get_continuation_history((ss - 2)->piece, (ss - 2)->move, piece,
+                                                          move);
             }
 
             scores[i] = value;
@@ -71,14 +89,48 @@ namespace elixir {
 
     void MovePicker::init_mp(const Board &board, move::Move tt_move, search::SearchStack *ss,
                              bool for_qs) {
-        if (for_qs)
-            moves = movegen::generate_moves<true>(board);
-        else
-            moves = movegen::generate_moves<false>(board);
+        if (for_qs) {
+            // Captures come out of the generator in MVV-LVA order, so they are not scored
+            movegen::generate_qs_moves(board, moves);
+            see_context.init(board);
+            presorted  = true;
+            next_index = 0;
+            for (int i = 0; i < moves.size(); i++) {
+                if (moves[i] == tt_move) {
+                    std::rotate(moves.begin(), moves.begin() + i, moves.begin() + i + 1);
+                    break;
+                }
+            }
+            return;
+        }
+
+        movegen::generate_moves<false>(board, moves);
         score_moves(board, tt_move, ss);
     }
 
+    void MovePicker::order_root_moves(const search::RootMoveList &root_moves,
+                                      move::Move tt_move) {
+        for (int i = 0; i < moves.size(); i++) {
+            if (moves[i] == tt_move)
+                continue;
+            for (int rank = 0; rank < root_moves.size(); rank++) {
+                if (root_moves[rank].move == moves[i]) {
+                    scores[i] = -rank;
+                    break;
+                }
+            }
+        }
+    }
+
     move::Move MovePicker::next_move() {
+        if (presorted) {
+            if (next_index >= moves.size())
+                return move::NO_MOVE;
+            current_move = moves[next_index++];
+            current_see  = SEE_UNKNOWN;
+            return current_move;
+        }
+
         if (moves.size() <= 0)
             return move::NO_MOVE;
 
@@ -92,14 +144,24 @@ namespace elixir {
         }
 
         auto best_move = moves[max_idx];
+        current_move   = best_move;
+        current_see    = see_values[max_idx];
 
         int last_index = moves.size() - 1;
         std::swap(moves[max_idx], moves[last_index]);
         std::swap(scores[max_idx], scores[last_index]);
+        std::swap(see_values[max_idx], see_values[last_index]);
 
         moves.pop_back();
         scores.pop_back();
+        see_values.pop_back();
 
         return best_move;
     }
+
+    int MovePicker::see() {
+        if (current_see == SEE_UNKNOWN)
+            current_see = see_context.value(current_move);
+        return current_see;
+    }
 }
\ No newline at end of file
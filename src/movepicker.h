@@ -1,5 +1,7 @@
 #pragma once
 
+#include <climits>
+
 #include "move.h"
 #include "movegen.h"
 #include "search.h"
@@ -7,12 +9,22 @@
 
 namespace elixir {
     extern int MP_SEE;
+    extern int MP_CAPTURE_HISTORY_DIVISOR;
     class MovePicker {
       public:
         MovePicker()  = default;
         ~MovePicker() = default;
         void init_mp(const Board &board, move::Move tt_move, search::SearchStack *ss, bool for_qs);
+        void order_root_moves(const search::RootMoveList &root_moves, move::Move tt_move);
         move::Move next_move();
+
+        /*
+        | Exact SEE value of the move last returned by next_move. Captures get it while they are  |
+        | scored, other moves only when first asked, and every later threshold check is a plain   |
+        | comparison.                                                                             |
+        */
+        int see();
+
         move::Move first_move() {
             if (moves.size() == 0)
                 return move::NO_MOVE;
@@ -20,8 +32,17 @@ namespace elixir {
         }
 
       private:
+        static constexpr int SEE_UNKNOWN = INT_MIN;
+
         MoveList moves;
         StaticVector<int, 256> scores;
+        StaticVector<int, 256> see_values;
+        move::Move current_move = move::NO_MOVE;
+        int current_see         = SEE_UNKNOWN;
+        search::SEEContext see_context;
+        // Set for qsearch, where moves are handed out in generation order from next_index
+        bool presorted         = false;
+        std::size_t next_index = 0;
         void score_moves(const Board &board, const move::Move &tt_move,
                          const search::SearchStack *ss);
     };
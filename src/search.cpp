@@ -1,17 +1,24 @@
 #include <algorithm>
 #include <cmath>
+#include <condition_variable>
 #include <iostream>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
 
 #include "search.h"
 
 #include "board/board.h"
 #include "evaluate.h"
+#include "history.h"
 #include "move.h"
 #include "movegen.h"
 #include "movepicker.h"
 #include "tt.h"
 #include "utils/bits.h"
 #include "utils/static_vector.h"
+#include "utils/sync_out.h"
 
 using namespace elixir::bits;
 
@@ -44,12 +51,24 @@ namespace elixir::search {
     double LMR_DIVISOR     = 1.711;
     int MIN_ASP_DEPTH      = 4;
     double ASP_MULTIPLIER  = 1.3111;
+
+    double TM_STABILITY_BASE    = 1.5;
+    double TM_STABILITY_STEP    = 0.15;
+    double TM_SCORE_MULTIPLIER  = 0.012;
+    double TM_SINGLE_MOVE_SCALE = 0.1;
+    double TM_NODE_BASE         = 1.5;
+    double TM_NODE_MULTIPLIER   = 1.35;
+
+    int SEE_CAPTURE_HISTORY_DIVISOR = 32;
 }
 
 namespace elixir::search {
 
     int see_pieces[7] = {SEE_PAWN, SEE_KNIGHT, SEE_BISHOP, SEE_ROOK, SEE_QUEEN, 0, 0};
 
+    std::atomic<bool> stop_flag{false};
+    std::atomic<bool> ponder_flag{false};
+
     int lmr[MAX_DEPTH][64] = {0};
     void init_lmr() {
         for (int depth = 0; depth < MAX_DEPTH; depth++) {
@@ -63,21 +82,69 @@ namespace elixir::search {
         }
     }
 
+    /*
+    | The hard limit is enforced by the timer, so checking for a stop is a relaxed load plus the |
+    | node limit comparison.                                                                     |
+    */
     bool should_stop(SearchInfo &info) {
-        if (info.timed && ! (info.nodes & 1023) &&
-            std::chrono::duration_cast<std::chrono::milliseconds>(
-                std::chrono::high_resolution_clock::now() - info.start_time)
-                    .count() > info.hard_limit) {
+        if (stop_flag.load(std::memory_order_relaxed) ||
+            (info.node_limit && info.nodes >= info.node_limit)) {
             info.stopped = true;
             return true;
         }
         return false;
     }
 
-    bool should_stop_early(SearchInfo &info) {
-        if (info.timed && std::chrono::duration_cast<std::chrono::milliseconds>(
-                              std::chrono::high_resolution_clock::now() - info.start_time)
-                                  .count() > info.soft_limit) {
+    /*
+    | Watchdog thread for timed searches. It sleeps until the hard limit and then raises |
+    | stop_flag. While pondering, it waits for ponderhit to publish the real limits.     |
+    */
+    class SearchTimer {
+      public:
+        explicit SearchTimer(const SearchInfo &info) {
+            if (info.timed)
+                thread = std::thread([this, &info] { run(info); });
+        }
+
+        ~SearchTimer() {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                done = true;
+            }
+            cv.notify_one();
+            if (thread.joinable())
+                thread.join();
+        }
+
+        SearchTimer(const SearchTimer &)            = delete;
+        SearchTimer &operator=(const SearchTimer &) = delete;
+
+      private:
+        void run(const SearchInfo &info) {
+            std::unique_lock<std::mutex> lock(mutex);
+            while (ponder_flag.load(std::memory_order_acquire)) {
+                if (cv.wait_for(lock, std::chrono::milliseconds(1), [this] { return done; }))
+                    return;
+            }
+
+            const auto deadline =
+                info.start_time + std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                      std::chrono::duration<F64, std::milli>(info.hard_limit));
+            if (! cv.wait_until(lock, deadline, [this] { return done; }))
+                stop_flag.store(true, std::memory_order_relaxed);
+        }
+
+        std::thread thread;
+        std::mutex mutex;
+        std::condition_variable cv;
+        bool done = false;
+    };
+
+    bool should_stop_early(SearchInfo &info, F64 soft_scale) {
+        if (info.timed && ! info.fixed_time && ! ponder_flag.load(std::memory_order_acquire) &&
+            std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::high_resolution_clock::now() - info.start_time)
+                    .count() > info.soft_limit * soft_scale) {
             info.stopped = true;
             return true;
         }
@@ -85,8 +152,10 @@ namespace elixir::search {
     }
 
     // (~20 ELO)
+    template <NodeType node>
     int qsearch(Board &board, int alpha, int beta, SearchInfo &info, PVariation &pv,
                 SearchStack *ss) {
+        constexpr bool pv_node = node != NodeType::NON_PV;
 
         pv.length = 0;
 
@@ -102,15 +171,8 @@ namespace elixir::search {
         if (board.is_repetition())
             return 0;
 
-        int best_score, eval = eval::evaluate(board);
-
         if (ss->ply >= MAX_DEPTH - 1)
-            return eval;
-
-        int legals     = 0;
-        auto local_pv  = PVariation();
-        auto best_move = move::Move();
-        best_score     = eval;
+            return eval::evaluate(board);
 
         ProbedEntry result;
         TTFlag tt_flag     = TT_NONE;
@@ -125,6 +187,19 @@ namespace elixir::search {
             return result.score;
         }
 
+        /*
+        | The TT is probed before evaluating, so a TT cutoff never pays for an evaluation, and a |
+        | stored static eval is reused instead of computed again.                                |
+        */
+        int best_score, eval = result.eval;
+        if (eval == INF)
+            eval = eval::evaluate(board);
+
+        int legals     = 0;
+        auto local_pv  = PVariation();
+        auto best_move = move::Move();
+        best_score     = eval;
+
         if (best_score >= beta) {
             return best_score;
         }
@@ -145,7 +220,7 @@ namespace elixir::search {
             | Q-Search Static Exchange Evaluation [SEE] Pruning (~55 ELO) : Skip moves that |
             | lose a lot of material.                                                       |
             */
-            if (! SEE(board, move, -QS_SEE_THRESHOLD))
+            if (mp.see() < -QS_SEE_THRESHOLD)
                 continue;
 
             if (! board.make_move(move))
@@ -154,7 +229,7 @@ namespace elixir::search {
             legals++;
             info.nodes++;
 
-            int score = -qsearch(board, -beta, -alpha, info, local_pv, ss);
+            int score = -qsearch<node>(board, -beta, -alpha, info, local_pv, ss);
             board.unmake_move(move, true);
 
             if (info.stopped)
@@ -166,7 +241,8 @@ namespace elixir::search {
 
                 if (score > alpha) {
                     alpha = score;
-                    pv.update(move, score, local_pv);
+                    if constexpr (pv_node)
+                        pv.update(move, score, local_pv);
                     flag = TT_EXACT;
                 }
 
@@ -176,18 +252,43 @@ namespace elixir::search {
                 }
             }
         }
-        tt->store_tt(board.get_hash_key(), best_score, best_move, 0, ss->ply, flag, pv);
+        tt->store_tt(board.get_hash_key(), best_score, eval, best_move, 0, ss->ply, flag);
         return best_score;
     }
 
+    bool is_root_move_skipped(const SearchInfo &info, const move::Move move) {
+        const auto &excluded = info.excluded_root_moves;
+        if (std::find(excluded.begin(), excluded.end(), move) != excluded.end())
+            return true;
+        const auto &allowed = info.search_moves;
+        return ! allowed.empty() && std::find(allowed.begin(), allowed.end(), move) == allowed.end();
+    }
+
+    PieceType captured_piece_type(const Board &board, const move::Move move) {
+        return move.is_en_passant() ? PieceType::PAWN
+                                    : board.piece_to_piecetype(board.piece_on(move.get_to()));
+    }
+
+    RootMove *find_root_move(SearchInfo &info, const move::Move move) {
+        for (auto &root_move : info.root_moves) {
+            if (root_move.move == move)
+                return &root_move;
+        }
+        return nullptr;
+    }
+
+    template <NodeType node>
     int negamax(Board &board, int alpha, int beta, int depth, SearchInfo &info, PVariation &pv,
                 SearchStack *ss) {
 
         pv.length = 0;
 
-        bool root_node = ss->ply == 0;
-        bool pv_node   = ((beta - alpha > 1) || root_node);
-        bool in_check  = board.is_in_check();
+        constexpr bool root_node = node == NodeType::ROOT;
+        constexpr bool pv_node   = node != NodeType::NON_PV;
+        // Only PV nodes hand a full window down; every other child searches a null window
+        constexpr NodeType pv_child = pv_node ? NodeType::PV : NodeType::NON_PV;
+
+        bool in_check = board.is_in_check();
         int eval;
 
         if (! root_node && should_stop(info))
@@ -210,7 +311,7 @@ namespace elixir::search {
         |
         */
         if (depth <= 0)
-            return qsearch(board, alpha, beta, info, pv, ss);
+            return qsearch<pv_child>(board, alpha, beta, info, pv, ss);
 
 
         if (! root_node) {
@@ -221,6 +322,16 @@ namespace elixir::search {
             if (board.is_repetition())
                 return 0;
 
+            /*
+            | Upcoming Repetition Detection : If a single move can repeat a position in the |
+            | search tree, the side to move can always hold at least a draw.                |
+            */
+            if (alpha < 0 && board.has_upcoming_repetition(ss->ply)) {
+                alpha = 0;
+                if (alpha >= beta)
+                    return alpha;
+            }
+
             if (ss->ply >= MAX_DEPTH - 1)
                 return eval::evaluate(board);
 
@@ -269,14 +380,32 @@ namespace elixir::search {
 
         /*
         | Initialize the evaluation score. If we are in check, we set the evaluation score to INF. |
-        | Otherwise, if we have a TT hit, we use the stored score. If not, we evaluate the position.
-        |
+        | Otherwise we take the raw static eval stored in the TT, and only evaluate the position  |
+        | if there is none.                                                                        |
         */
+        int static_eval = INF, raw_eval = result.eval;
         if (in_check)
             eval = ss->eval = INF;
 
-        else
-            eval = ss->eval = (tt_hit) ? result.score : eval::evaluate(board);
+        else {
+            if (raw_eval == INF)
+                raw_eval = eval::evaluate(board);
+            /*
+            | Correction History : Shift the static eval by the error search has found for this  |
+            | pawn structure before.                                                             |
+            */
+            static_eval = history->correct_eval(board.get_side_to_move(), board.get_pawn_key(),
+                                                raw_eval);
+            eval = ss->eval = static_eval;
+
+            /*
+            | A TT score is a better guess than the static eval whenever its bound points the same |
+            | way, so pruning uses it. ss->eval and correction history keep the static eval.       |
+            */
+            if (tt_hit && (tt_flag == TT_EXACT || (tt_flag == TT_BETA && result.score > eval) ||
+                           (tt_flag == TT_ALPHA && result.score < eval)))
+                eval = result.score;
+        }
 
         if (! pv_node && ! in_check) {
             /*
@@ -284,7 +413,8 @@ namespace elixir::search {
             | quiescence search, if we still cant exceed alpha, then we cutoff.         |
             */
             if (depth <= RAZOR_DEPTH && eval + RAZOR_MARGIN * depth < alpha) {
-                const int razor_score = qsearch(board, alpha, beta, info, local_pv, ss);
+                const int razor_score =
+                    qsearch<NodeType::NON_PV>(board, alpha, beta, info, local_pv, ss);
                 if (razor_score <= alpha) {
                     return razor_score;
                 }
@@ -309,10 +439,12 @@ namespace elixir::search {
                 | Set current move to a null move in the search stack to avoid |
                 | multiple null move searching in a row.                       |
                 */
-                ss->move = move::NO_MOVE;
+                ss->move  = move::NO_MOVE;
+                ss->piece = Piece::NO_PIECE;
 
                 board.make_null_move();
-                int score = -negamax(board, -beta, -beta + 1, depth - R, info, local_pv, ss + 1);
+                int score = -negamax<NodeType::NON_PV>(board, -beta, -beta + 1, depth - R, info,
+                                                       local_pv, ss + 1);
                 board.unmake_null_move();
 
                 /*
@@ -330,21 +462,35 @@ namespace elixir::search {
         */
         MovePicker mp;
         mp.init_mp(board, tt_move, ss, false);
-        if (root_node)
-            info.best_root_move = mp.first_move();
+        /*
+        | Root Move Ordering : After the first iteration, root moves other than the TT move are |
+        | ordered by the nodes they took in the previous iteration.                             |
+        */
+        if (root_node && depth > 1)
+            mp.order_root_moves(info.root_moves, tt_move);
+        /*
+        | Root moves already reported by an earlier MultiPV line, or left out by searchmoves, are |
+        | skipped.                                                                                |
+        */
+        const bool restricted_root =
+            root_node && (! info.excluded_root_moves.empty() || ! info.search_moves.empty());
 
         TTFlag flag = TT_ALPHA;
         move::Move move;
         bool skip_quiets = false;
 
         /*
-        | Initialize a bad quiets array to be used by history maluses. |
+        | Initialize bad quiets and bad captures arrays to be used by history maluses. |
         */
-        MoveList bad_quiets;
+        MoveList bad_quiets, bad_captures;
 
         while ((move = mp.next_move()) != move::NO_MOVE) {
 
             const bool is_quiet_move = move.is_quiet();
+            const Piece moved_piece  = board.piece_on(move.get_from());
+
+            if (restricted_root && is_root_move_skipped(info, move))
+                continue;
 
             /*
             | If skip_quiets is enabled by Late Move Pruning, we skip quiet |
@@ -377,25 +523,37 @@ namespace elixir::search {
 
                 /*
                 | Static Exchange Evaluation [SEE] Pruning (~20 ELO) : Skip moves that |
-                | lose a lot a material.                                               |
+                | lose a lot a material. Captures with a good capture history are      |
+                | allowed to lose more.                                                |
                 */
                 const int see_threshold =
-                    is_quiet_move ? -SEE_QUIET * depth : -SEE_CAPTURE * depth * depth;
-                if (depth <= SEE_DEPTH && legals > 0 && ! SEE(board, move, see_threshold))
+                    is_quiet_move
+                        ? -SEE_QUIET * depth
+                        : -SEE_CAPTURE * depth * depth -
+                              history->get_capture_history(moved_piece, move,
+                                                           captured_piece_type(board, move)) /
+                                  SEE_CAPTURE_HISTORY_DIVISOR;
+                if (depth <= SEE_DEPTH && legals > 0 && mp.see() < see_threshold)
                     continue;
             }
 
+            const U64 nodes_before = info.nodes;
+
             if (! board.make_move(move))
                 continue;
 
             /*
             | Add the current move to search stack. |
             */
-            ss->move = move;
+            ss->move  = move;
+            ss->piece = moved_piece;
 
             legals++;
             info.nodes++;
 
+            if (root_node && legals == 1 && ! restricted_root)
+                info.best_root_move = move;
+
             /*
             | Principal Variation Search and Late Move Reduction [PVS + LMR] (~40 ELO) |
             */
@@ -404,7 +562,7 @@ namespace elixir::search {
             | Search with full depth if it's the first move |
             */
             if (legals == 1) {
-                score = -negamax(board, -beta, -alpha, depth - 1, info, local_pv, ss + 1);
+                score = -negamax<pv_child>(board, -beta, -alpha, depth - 1, info, local_pv, ss + 1);
             } else {
                 /*
                 | Late Move Reductions [LMR] : Moves that appear later in the move list |
@@ -419,14 +577,24 @@ namespace elixir::search {
                 | to see if the move has potential to improve alpha. If it does, we perform a full |
                 | depth search.                                                                    |
                 */
-                score = -negamax(board, -alpha - 1, -alpha, depth - R, info, local_pv, ss + 1);
+                score = -negamax<NodeType::NON_PV>(board, -alpha - 1, -alpha, depth - R, info,
+                                                   local_pv, ss + 1);
                 if (score > alpha && (score < beta || R > 1)) {
-                    score = -negamax(board, -beta, -alpha, depth - 1, info, local_pv, ss + 1);
+                    score = -negamax<pv_child>(board, -beta, -alpha, depth - 1, info, local_pv,
+                                               ss + 1);
                 }
             }
 
             board.unmake_move(move, true);
 
+            if (root_node) {
+                if (RootMove *root_move = find_root_move(info, move)) {
+                    root_move->nodes += info.nodes - nodes_before;
+                    if (! info.stopped)
+                        root_move->score = score;
+                }
+            }
+
             if (info.stopped)
                 return 0;
 
@@ -434,7 +602,7 @@ namespace elixir::search {
                 best_move  = move;
                 best_score = score;
                 if (score > alpha) {
-                    if (pv_node)
+                    if constexpr (pv_node)
                         pv.update(move, score, local_pv);
                     if (score >= beta) {
                         if (is_quiet_move) {
@@ -442,8 +610,30 @@ namespace elixir::search {
                                 ss->killers[1] = ss->killers[0];
                                 ss->killers[0] = best_move;
                             }
-                            board.history.update_history(move.get_from(), move.get_to(), depth,
-                                                         bad_quiets);
+                            history->update_history(board.get_side_to_move(), move.get_from(),
+                                                    move.get_to(), depth, bad_quiets);
+                            /*
+                            | Continuation History and Counter Moves : Reward the quiet move as a |
+                            | follow-up to the last two moves, and as the reply to the last one.  |
+                            */
+                            history->update_continuation_history(
+                                board, (ss - 1)->piece, (ss - 1)->move, move, depth, bad_quiets);
+                            history->update_continuation_history(
+                                board, (ss - 2)->piece, (ss - 2)->move, move, depth, bad_quiets);
+                            history->update_counter_move((ss - 1)->piece, (ss - 1)->move, move);
+                        } else {
+                            history->update_capture_history(moved_piece, move,
+                                                            captured_piece_type(board, move),
+                                                            depth * depth);
+                        }
+                        /*
+                        | Capture History : Every capture searched before the cutoff move failed |
+                        | to cut, whatever kind of move finally did.                             |
+                        */
+                        for (const auto &bad_capture : bad_captures) {
+                            history->update_capture_history(
+                                board.piece_on(bad_capture.get_from()), bad_capture,
+                                captured_piece_type(board, bad_capture), -depth * depth);
                         }
                         flag = TT_BETA;
                         break;
@@ -456,17 +646,45 @@ namespace elixir::search {
             else if (is_quiet_move) {
                 bad_quiets.push(move);
             }
+
+            else {
+                bad_captures.push(move);
+            }
         }
 
         if (legals == 0) {
             return board.is_in_check() ? -MATE + ss->ply : 0;
         }
 
-        tt->store_tt(board.get_hash_key(), best_score, best_move, depth, ss->ply, flag, pv);
+        /*
+        | Update the correction history with the gap between the static eval and the search result, |
+        | unless the bound says nothing about it or a capture decided the score.                    |
+        */
+        if (static_eval != INF && ! restricted_root && std::abs(best_score) < MATE_FOUND &&
+            (best_move == move::NO_MOVE || best_move.is_quiet()) &&
+            ! (flag == TT_BETA && best_score <= static_eval) &&
+            ! (flag == TT_ALPHA && best_score >= static_eval)) {
+            history->update_correction_history(board.get_side_to_move(), board.get_pawn_key(), depth,
+                                               best_score - static_eval);
+        }
+
+        /*
+        | A root search over a subset of moves is not the real best line, so keep it out of the TT. |
+        */
+        if (! restricted_root)
+            tt->store_tt(board.get_hash_key(), best_score, raw_eval, best_move, depth, ss->ply,
+                         flag);
 
         return best_score;
     }
 
+    template int qsearch<NodeType::PV>(Board &board, int alpha, int beta, SearchInfo &info,
+                                       PVariation &pv, SearchStack *ss);
+    template int qsearch<NodeType::NON_PV>(Board &board, int alpha, int beta, SearchInfo &info,
+                                           PVariation &pv, SearchStack *ss);
+    template int negamax<NodeType::ROOT>(Board &board, int alpha, int beta, int depth,
+                                         SearchInfo &info, PVariation &pv, SearchStack *ss);
+
     int get_promo_piece(move::Move move) {
         switch (move.get_promotion()) {
             case move::Promotion::QUEEN:
@@ -514,8 +732,7 @@ namespace elixir::search {
                                       8 * color_offset[static_cast<int>(board.get_side_to_move())])
                 : to;
         Bitboard occupied  = board.occupancy() ^ bit(from) ^ bit(sq);
-        Bitboard attackers = board.get_attackers(to, Color::WHITE, occupied) |
-                             board.get_attackers(to, Color::BLACK, occupied);
+        Bitboard attackers = board.get_attackers(to, occupied);
 
         Bitboard bishops = board.bishops() | board.queens();
         Bitboard rooks   = board.rooks() | board.queens();
@@ -563,94 +780,353 @@ namespace elixir::search {
         return side != board.piece_color(board.piece_on(from));
     }
 
+    /*
+    | Exact Static Exchange Evaluation with a swap list. SEE(board, move, threshold) is the same |
+    | as see_value(board, move) >= threshold, so a caller that checks several thresholds for one |
+    | move can compute this once and compare integers afterwards. Promotions are never pruned by |
+    | SEE, so they get INF.                                                                      |
+    */
+    int see_value(const Board &board, const move::Move move, const int see_values[7]) {
+        SEEContext context;
+        context.init(board);
+        return context.value(move, see_values);
+    }
+
+    void SEEContext::init(const Board &board) {
+        this->board   = &board;
+        occupancy     = board.occupancy();
+        bishops       = board.bishops() | board.queens();
+        rooks         = board.rooks() | board.queens();
+        known_targets = 0ULL;
+    }
+
+    Bitboard SEEContext::attackers_of(const Square sq) {
+        const Bitboard mask = bit(sq);
+        if (! (known_targets & mask)) {
+            target_attackers[static_cast<int>(sq)] = board->get_attackers(sq, occupancy);
+            known_targets |= mask;
+        }
+        return target_attackers[static_cast<int>(sq)];
+    }
+
+    int SEEContext::value(const move::Move move, const int see_values[7]) {
+
+        if (move.is_promotion())
+            return INF;
+
+        Square from = move.get_from();
+        Square to   = move.get_to();
+
+        int gain[40], d = 0;
+        const Piece captured = board->piece_on(to);
+        gain[0] = see_values[move.is_en_passant()
+                                 ? 0
+                                 : static_cast<int>(board->piece_to_piecetype(captured))];
+
+        int attacker = static_cast<int>(board->piece_to_piecetype(board->piece_on(from)));
+
+        Bitboard occupied = occupancy ^ bit(from);
+        Bitboard attackers;
+        if (move.is_en_passant()) {
+            // The captured pawn is not on the target square and may uncover sliders of its own
+            const Square sq = static_cast<Square>(
+                static_cast<int>(to) -
+                8 * color_offset[static_cast<int>(board->get_side_to_move())]);
+            occupied ^= bit(sq);
+            attackers = board->get_attackers(to, occupied);
+        } else {
+            occupied ^= bit(to);
+            // Lifting the moving piece can uncover sliders behind it
+            attackers = attackers_of(to);
+            if (attacker != static_cast<int>(PieceType::KNIGHT))
+                attackers |= (attacks::get_bishop_attacks(to, occupied) & bishops) |
+                             (attacks::get_rook_attacks(to, occupied) & rooks);
+        }
+
+        Color side = board->piece_color(board->piece_on(from));
+        side       = (side == Color::WHITE) ? Color::BLACK : Color::WHITE;
+
+        while (true) {
+            d++;
+            // Speculative gain if side recaptures the piece that just captured on the target
+            gain[d] = see_values[attacker] - gain[d - 1];
+
+            attackers &= occupied;
+
+            Bitboard my_attackers = attackers & board->color_occupancy(side);
+            if (! my_attackers)
+                break;
+
+            // Pick least valuable attacker
+            int piece;
+            for (piece = 0; piece < 6; piece++) {
+                if (my_attackers & board->piece_bitboard(static_cast<PieceType>(piece))) {
+                    break;
+                }
+            }
+
+            Color enemy_side = (side == Color::WHITE) ? Color::BLACK : Color::WHITE;
+
+            // The king can only recapture if the target is no longer defended
+            if (piece == 5 && (attackers & board->color_occupancy(enemy_side)))
+                break;
+
+            occupied ^= bit(static_cast<Square>(
+                lsb_index(my_attackers & board->piece_bitboard(static_cast<PieceType>(piece)))));
+
+            if (piece == 0 || piece == 2 || piece == 4) {
+                attackers |= attacks::get_bishop_attacks(to, occupied) & bishops;
+            }
+            if (piece == 3 || piece == 4) {
+                attackers |= attacks::get_rook_attacks(to, occupied) & rooks;
+            }
+
+            attacker = piece;
+            side     = enemy_side;
+        }
+
+        while (--d) {
+            gain[d - 1] = -std::max(-gain[d - 1], gain[d]);
+        }
+
+        return gain[0];
+    }
+
+    void print_info_line(const PVariation &pv, int multipv, int depth, SearchInfo &info,
+                         int time_ms) {
+        const int score = pv.score;
+        const int nps   = info.nodes * 1000 / (time_ms + 1);
+        SyncOut out;
+        out << "info multipv " << multipv;
+        if (score > -MATE && score < -MATE_FOUND) {
+            out << " score mate " << -(score + MATE) / 2;
+        } else if (score > MATE_FOUND && score < MATE) {
+            out << " score mate " << (MATE - score) / 2 + 1;
+        } else {
+            out << " score cp " << score;
+        }
+        out << " depth " << depth << " seldepth " << info.seldepth << " nodes " << info.nodes
+            << " time " << time_ms << " nps " << nps << " hashfull " << tt->get_hashfull() << " pv "
+            << pv.to_uci();
+    }
+
+    void init_root_moves(Board &board, SearchInfo &info) {
+        info.root_moves.clear();
+        MoveList moves;
+        movegen::generate_moves<false>(board, moves);
+        for (const auto &move : moves) {
+            if (! board.make_move(move))
+                continue;
+            board.unmake_move(move, true);
+
+            const auto &allowed = info.search_moves;
+            if (! allowed.empty() &&
+                std::find(allowed.begin(), allowed.end(), move) == allowed.end())
+                continue;
+
+            RootMove root_move;
+            root_move.move = move;
+            info.root_moves.push(root_move);
+        }
+    }
+
+    /*
+    | Sort root moves by the nodes they took in the last iteration and reset the counters for the |
+    | next one.                                                                                   |
+    */
+    void sort_root_moves(SearchInfo &info) {
+        std::stable_sort(info.root_moves.begin(), info.root_moves.end(),
+                         [](const RootMove &a, const RootMove &b) {
+                             return a.nodes != b.nodes ? a.nodes > b.nodes : a.score > b.score;
+                         });
+        for (auto &root_move : info.root_moves) {
+            root_move.previous_score = root_move.score;
+            root_move.score          = -INF;
+            root_move.nodes          = 0;
+        }
+    }
+
     void search(Board &board, SearchInfo &info, bool print_info) {
         auto start = std::chrono::high_resolution_clock::now();
-        PVariation pv;
+
+        history->age();
+        tt->new_search();
+
+        /*
+        | MultiPV : Each line is a full root search that excludes the best moves of the lines |
+        | before it. All lines share the TT and history, so later lines are much cheaper.     |
+        */
+        init_root_moves(board, info);
+        const int root_moves = info.root_moves.size();
+        if (root_moves > 0)
+            info.best_root_move = info.root_moves[0].move;
+        const int multipv = std::clamp(root_moves, 1, std::max(1, info.multipv));
+        std::vector<PVariation> lines(multipv);
+        PVariation &best_pv = lines[0];
+
+        move::Move previous_best_move = move::NO_MOVE;
+        int previous_score = 0, best_move_stability = 0;
+
+        std::optional<SearchTimer> timer;
+        timer.emplace(info);
+
+        /*
+        | The search stack lives across iterations, so killers found at one depth still order  |
+        | moves at the next.                                                                   |
+        */
+        SearchStack stack[MAX_DEPTH + 4], *ss = stack + 4;
+        for (int i = -4; i < MAX_DEPTH; i++) {
+            (ss + i)->move       = move::NO_MOVE;
+            (ss + i)->piece      = Piece::NO_PIECE;
+            (ss + i)->killers[0] = move::NO_MOVE;
+            (ss + i)->killers[1] = move::NO_MOVE;
+            (ss + i)->eval       = INF;
+        }
+
+        for (int i = 0; i < MAX_DEPTH; i++) {
+            (ss + i)->ply = i;
+        }
+
         for (int current_depth = 1; current_depth <= info.depth; current_depth++) {
             info.seldepth = 0;
-            int score = 0, alpha = -INF, beta = INF, delta = INITIAL_ASP_DELTA;
-            SearchStack stack[MAX_DEPTH + 4], *ss = stack + 4;
-            for (int i = -4; i < MAX_DEPTH; i++) {
-                (ss + i)->move       = move::NO_MOVE;
-                (ss + i)->killers[0] = move::NO_MOVE;
-                (ss + i)->killers[1] = move::NO_MOVE;
-                (ss + i)->eval       = INF;
-            }
 
-            for (int i = 0; i < MAX_DEPTH; i++) {
-                (ss + i)->ply = i;
-            }
+            info.excluded_root_moves.clear();
+            if (current_depth > 1)
+                sort_root_moves(info);
+            int completed_lines = 0;
 
-            if (info.depth >= MIN_ASP_DEPTH) {
-                alpha = std::max(-INF, score - delta);
-                beta  = std::min(INF, score + delta);
-            }
+            for (int pv_idx = 0; pv_idx < multipv; pv_idx++) {
+                PVariation pv;
+                int score = 0, alpha = -INF, beta = INF, delta = INITIAL_ASP_DELTA;
+
+                /*
+                | Aspiration Windows : Centre the window on the score this line had in the |
+                | previous iteration.                                                      |
+                */
+                if (current_depth >= MIN_ASP_DEPTH && lines[pv_idx].length > 0) {
+                    score = lines[pv_idx].score;
+                    alpha = std::max(-INF, score - delta);
+                    beta  = std::min(INF, score + delta);
+                }
 
-            // aspiration windows
-            while (1) {
-                score = negamax(board, alpha, beta, current_depth, info, pv, ss);
+                // aspiration windows
+                while (1) {
+                    score =
+                        negamax<NodeType::ROOT>(board, alpha, beta, current_depth, info, pv, ss);
 
-                if (score > alpha && score < beta)
-                    break;
+                    if (score > alpha && score < beta)
+                        break;
 
-                if (score <= alpha) {
-                    beta  = (alpha + beta) / 2;
-                    alpha = std::max(-INF, alpha - delta);
-                }
+                    if (score <= alpha) {
+                        beta  = (alpha + beta) / 2;
+                        alpha = std::max(-INF, alpha - delta);
+                    }
+
+                    else if (score >= beta) {
+                        beta = std::min(INF, beta + delta);
+                    }
 
-                else if (score >= beta) {
-                    beta = std::min(INF, beta + delta);
+                    delta *= ASP_MULTIPLIER;
+
+                    if (should_stop(info))
+                        break;
+                    if (info.stopped)
+                        break;
                 }
 
-                delta *= ASP_MULTIPLIER;
+                /*
+                | Keep the last line that was actually searched; a stopped iteration may have |
+                | cleared the root PV before finishing its first move.                        |
+                */
+                if (pv.length > 0 && (! info.stopped || pv_idx == 0))
+                    lines[pv_idx] = pv;
 
-                if (should_stop(info))
-                    break;
-                if (info.stopped)
+                if (info.stopped || pv.length == 0)
                     break;
+
+                info.excluded_root_moves.push(pv.line[0]);
+                completed_lines++;
             }
 
             auto end      = std::chrono::high_resolution_clock::now();
             auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
 
-            if (print_info && pv.line[0] != move::NO_MOVE) {
-                int time_ms = duration.count();
-                int nps     = info.nodes * 1000 / (time_ms + 1);
-                if (score > -MATE && score < -MATE_FOUND) {
-                    std::cout << "info score mate " << -(score + MATE) / 2 << " depth "
-                              << current_depth << " seldepth " << info.seldepth << " nodes "
-                              << info.nodes << " time " << time_ms << " nps " << nps << " hashfull "
-                              << tt->get_hashfull() << " pv ";
+            if (print_info) {
+                for (int i = 0; i < completed_lines; i++) {
+                    print_info_line(lines[i], i + 1, current_depth, info, duration.count());
                 }
+            }
 
-                else if (score > MATE_FOUND && score < MATE) {
-                    std::cout << "info score mate " << (MATE - score) / 2 + 1 << " depth "
-                              << current_depth << " seldepth " << info.seldepth << " nodes "
-                              << info.nodes << " time " << time_ms << " nps " << nps << " hashfull "
-                              << tt->get_hashfull() << " pv ";
-                }
+            /*
+            | go mate N : stop as soon as a mate in N or fewer moves has been proven. |
+            */
+            if (info.mate_limit && completed_lines && lines[0].score > MATE_FOUND &&
+                (MATE - lines[0].score) / 2 + 1 <= info.mate_limit)
+                break;
+
+            /*
+            | Time Management : Scale the soft limit with how settled the search looks. A best move |
+            | that keeps surviving iterations saves time, a falling score buys more, and a single   |
+            | legal move needs almost none.                                                         |
+            */
+            F64 soft_scale = 1.0;
+            if (completed_lines && ! info.fixed_time) {
+                const move::Move best_move = lines[0].line[0];
+                best_move_stability =
+                    (best_move == previous_best_move) ? std::min(best_move_stability + 1, 6) : 0;
+
+                const F64 stability_scale =
+                    TM_STABILITY_BASE - TM_STABILITY_STEP * best_move_stability;
+                const F64 score_scale = std::clamp(
+                    1.0 + TM_SCORE_MULTIPLIER * (previous_score - lines[0].score), 0.7, 1.6);
+                soft_scale = stability_scale * (current_depth > 1 ? score_scale : 1.0);
+                if (root_moves == 1)
+                    soft_scale *= TM_SINGLE_MOVE_SCALE;
 
-                else {
-                    std::cout << "info score cp " << score << " depth " << current_depth
-                              << " seldepth " << info.seldepth << " nodes " << info.nodes
-                              << " time " << time_ms << " nps " << nps << " hashfull "
-                              << tt->get_hashfull() << " pv ";
+                /*
+                | Node Fraction : The more of the iteration went into the best move, the less |
+                | likely another move is to overtake it.                                      |
+                */
+                U64 total_nodes = 0;
+                for (const auto &root_move : info.root_moves) {
+                    total_nodes += root_move.nodes;
+                }
+                const RootMove *best_root = find_root_move(info, best_move);
+                if (best_root && total_nodes > 0) {
+                    const F64 node_fraction = static_cast<F64>(best_root->nodes) / total_nodes;
+                    soft_scale *= (TM_NODE_BASE - node_fraction) * TM_NODE_MULTIPLIER;
                 }
-                pv.print_pv();
-                std::cout << std::endl;
+
+                previous_best_move = best_move;
+                previous_score     = lines[0].score;
             }
 
-            if (should_stop_early(info))
+            if (should_stop_early(info, soft_scale))
                 break;
             if (info.stopped)
                 break;
         }
 
+        timer.reset();
+
+        /*
+        | A finished ponder or infinite search must not report a move before ponderhit or stop. |
+        */
+        while (print_info && (ponder_flag.load(std::memory_order_acquire) || info.infinite) &&
+               ! stop_flag.load(std::memory_order_relaxed)) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+
         if (print_info) {
-            std::cout << "bestmove ";
-            (pv.line[0] != move::NO_MOVE) ? pv.line[0].print_uci()
-                                          : info.best_root_move.print_uci();
-            std::cout << std::endl;
+            SyncOut out;
+            out << "bestmove "
+                << ((best_pv.length > 0) ? best_pv.line[0] : info.best_root_move).to_uci();
+            /*
+            | The second PV move is the reply we expect, so the GUI can let us ponder on it. |
+            */
+            if (best_pv.length >= 2) {
+                out << " ponder " << best_pv.line[1].to_uci();
+            }
         }
     }
 }
\ No newline at end of file
@@ -1,8 +1,10 @@
 #pragma once
 
 #include <array>
+#include <atomic>
 #include <chrono>
 #include <span>
+#include <string>
 
 #include "board/board.h"
 #include "move.h"
@@ -10,11 +12,24 @@
 namespace elixir::search {
     struct SearchStack {
         move::Move move       = move::NO_MOVE;
+        Piece piece           = Piece::NO_PIECE; // moving piece of move, as moves do not carry it
         move::Move killers[2] = {};
         int eval;
         int ply;
     };
 
+    /*
+    | Per root move bookkeeping, kept across iterations for time management and root ordering. |
+    */
+    struct RootMove {
+        move::Move move    = move::NO_MOVE;
+        U64 nodes          = 0;
+        int score          = -INF;
+        int previous_score = -INF;
+    };
+
+    using RootMoveList = StaticVector<RootMove, 256>;
+
     class SearchInfo {
       public:
         SearchInfo() = default;
@@ -38,6 +53,16 @@ namespace elixir::search {
         F64 soft_limit;
         F64 hard_limit;
         move::Move best_root_move;
+        int multipv    = 1;
+        U64 node_limit = 0;
+        int mate_limit = 0;
+        // go movetime: spend the whole budget, with no soft limit scaling or early stop
+        bool fixed_time = false;
+        // go infinite: bestmove is held back until the GUI sends stop
+        bool infinite = false;
+        MoveList search_moves;
+        MoveList excluded_root_moves;
+        RootMoveList root_moves;
     };
 
     struct PVariation {
@@ -45,21 +70,21 @@ namespace elixir::search {
         int score;
         std::array<move::Move, 256> line;
 
-        PVariation() : length(0), score(0) {
-            for (auto &move : line) {
-                move = move::NO_MOVE;
-            }
-        }
+        // Only the first length moves are ever read, so the line is left uninitialised
+        PVariation() : length(0), score(0) {}
 
         std::span<move::Move> moves() { return std::span<move::Move>(line.data(), length); }
 
         int score_value() const { return score; }
 
-        void print_pv() const {
+        std::string to_uci() const {
+            std::string uci;
             for (int i = 0; i < length; i++) {
-                line[i].print_uci();
-                std::cout << " ";
+                if (i > 0)
+                    uci += " ";
+                uci += line[i].to_uci();
             }
+            return uci;
         }
 
         void update(const move::Move m, const int s, const PVariation &rest) {
@@ -98,15 +123,66 @@ namespace elixir::search {
     extern double LMR_DIVISOR;
     extern int MIN_ASP_DEPTH;
     extern double ASP_MULTIPLIER;
+    extern double TM_STABILITY_BASE;
+    extern double TM_STABILITY_STEP;
+    extern double TM_SCORE_MULTIPLIER;
+    extern double TM_SINGLE_MOVE_SCALE;
+    extern double TM_NODE_BASE;
+    extern double TM_NODE_MULTIPLIER;
+    extern int SEE_CAPTURE_HISTORY_DIVISOR;
 
     extern int see_pieces[7];
 
+    /*
+    | Set by the UCI thread to halt a running search. It is polled at every node, so it has to stay |
+    | cheap to read.                                                                                |
+    */
+    extern std::atomic<bool> stop_flag;
+
+    /*
+    | Set while searching on the opponent's time. Time limits are ignored until the UCI thread |
+    | publishes the real ones on ponderhit and clears the flag.                                |
+    */
+    extern std::atomic<bool> ponder_flag;
+
     extern int lmr[MAX_DEPTH][64];
     void init_lmr();
 
+    /*
+    | The search is instantiated per node type, like generate_moves<noisy>. Non-PV nodes, which |
+    | are nearly all of them, compile without the root and PV bookkeeping.                       |
+    */
+    enum class NodeType { ROOT, PV, NON_PV };
+
+    template <NodeType node>
+    int qsearch(Board &board, int alpha, int beta, SearchInfo &info, PVariation &pv,
+                SearchStack *ss);
+    template <NodeType node>
     int negamax(Board &board, int alpha, int beta, int depth, SearchInfo &info, PVariation &pv,
                 SearchStack *ss);
     bool SEE(const Board &board, const move::Move move, int threshold,
              const int see_values[7] = see_pieces);
+    int see_value(const Board &board, const move::Move move, const int see_values[7] = see_pieces);
+
+    /*
+    | Batched SEE for all moves of one position. The occupancy and slider sets are taken once, |
+    | and the attackers of each target square are found once however many moves go there.     |
+    | The board must stay in the position init was called with.                                |
+    */
+    class SEEContext {
+      public:
+        void init(const Board &board);
+        int value(const move::Move move, const int see_values[7] = see_pieces);
+
+      private:
+        Bitboard attackers_of(const Square sq);
+
+        const Board *board     = nullptr;
+        Bitboard occupancy     = 0ULL;
+        Bitboard bishops       = 0ULL;
+        Bitboard rooks         = 0ULL;
+        Bitboard known_targets = 0ULL;
+        std::array<Bitboard, 64> target_attackers;
+    };
     void search(Board &board, SearchInfo &info, bool print_info = true);
 }
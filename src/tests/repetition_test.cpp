@@ -0,0 +1,74 @@
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "../board/board.h"
+#include "../utils/str_utils.h"
+#include "repetition_test.h"
+
+namespace elixir {
+    namespace tests {
+
+        struct RepetitionCase {
+            std::string fen;
+            // UCI moves, with "null" for a null move
+            std::string moves;
+            bool upcoming;
+            bool repetition;
+        };
+
+        /*
+        | A null move flips the side to move like a real move, so keys an odd number of plies back |
+        | can differ by one move that only a null move made reachable. Neither scan may count      |
+        | positions from before the last null move.                                                |
+        */
+        const RepetitionCase repetition_suite[4] = {
+            // The black king can step back to e8 and repeat the start position
+            {"4k3/8/8/8/8/8/8/R3K3 w - - 0 1", "e1d1 e8d8 d1e1", true, false},
+            // The rook hop a1-a5 spans a null move; black cannot move a white rook
+            {"4k3/8/8/8/8/8/8/R3K3 w - - 0 1", "a1a4 null a4a5", false, false},
+            // The white king returns home, but only because black passed
+            {"4k3/8/8/8/8/8/8/R3K3 w - - 0 1", "e1d1 null d1e1 null", false, false},
+            // Played out for real, the same king walk is a repetition
+            {"4k3/8/8/8/8/8/8/R3K3 w - - 0 1", "e1d1 e8d8 d1e1 d8e8", true, true},
+        };
+
+        void repetition_test() {
+            std::cout << "-------------------------------------------------------------------------"
+                         "-----------------------------------------------------\n";
+            std::cout << "Running repetition test..." << std::endl;
+            std::cout << "-------------------------------------------------------------------------"
+                         "-----------------------------------------------------\n"
+                      << std::endl;
+
+            int counter = 1;
+            for (const auto &entry : repetition_suite) {
+                Board board(entry.fen);
+                for (const auto &move : str_utils::split(entry.moves, ' ')) {
+                    if (move == "null")
+                        board.make_null_move();
+                    else
+                        board.play_uci_move(move);
+                }
+
+                // A ply deep enough that every scanned position lies inside the search tree
+                const bool upcoming   = board.has_upcoming_repetition(64);
+                const bool repetition = board.is_repetition();
+                if (upcoming != entry.upcoming || repetition != entry.repetition) {
+                    std::cerr << "ELIXIR_REPETITION_FAILED: repetition test [" << counter << "] ["
+                              << entry.fen << " | " << entry.moves << "] failed!" << std::endl;
+                    return;
+                }
+                std::cout << "Repetition test [" << counter++ << "] [" << entry.fen << " | "
+                          << entry.moves << "] passed!" << std::endl;
+            }
+
+            std::cout << std::endl;
+            std::cout << "-------------------------------------------------------------------------"
+                         "-----------------------------------------------------\n";
+            std::cout << "Repetition test passed!" << std::endl;
+            std::cout << "-------------------------------------------------------------------------"
+                         "-----------------------------------------------------\n";
+        }
+    }
+}
\ No newline at end of file
@@ -0,0 +1,7 @@
+#pragma once
+
+namespace elixir {
+    namespace tests {
+        void repetition_test();
+    }
+}
\ No newline at end of file
@@ -5,6 +5,7 @@
 #include "../board/board.h"
 #include "../defs.h"
 #include "../move.h"
+#include "../movegen.h"
 #include "../search.h"
 #include "../types.h"
 #include "../utils/str_utils.h"
@@ -117,9 +118,28 @@ namespace elixir {
                 }
 
                 const int threshold = std::stoi(str_utils::remove_whitespaces(data[2]));
-                if ((search::SEE(board, move, threshold, see_values) &&
-                     ! search::SEE(board, move, threshold + 1, see_values)) ||
-                    is_promotion) {
+
+                // One batched context shared by every move of the position must agree with the
+                // threshold form, however the attacker sets were filled by earlier moves
+                bool batched = true;
+                search::SEEContext context;
+                context.init(board);
+                MoveList moves;
+                movegen::generate_moves<false>(board, moves);
+                for (const auto &other : moves) {
+                    if (other.is_promotion())
+                        continue;
+                    const int value = context.value(other, see_values);
+                    if (! search::SEE(board, other, value, see_values) ||
+                        search::SEE(board, other, value + 1, see_values))
+                        batched = false;
+                }
+
+                // The threshold form and the exact swap list value must agree
+                if (batched && ((search::SEE(board, move, threshold, see_values) &&
+                                 ! search::SEE(board, move, threshold + 1, see_values) &&
+                                 search::see_value(board, move, see_values) == threshold) ||
+                                is_promotion)) {
                     std::cout << "SEE test [" << counter << "] [" << entry << "] passed!"
                               << std::endl;
                 } else {
@@ -1,3 +1,5 @@
+#include <algorithm>
+#include <cstring>
 #include <iostream>
 
 #include "defs.h"
@@ -12,12 +14,13 @@ namespace elixir {
     TranspositionTable tt[1];
 
     void TranspositionTable::clear_tt() {
-        entries = 0;
-        std::fill(table.begin(), table.end(), TTEntry());
+        age = 0;
+        std::memset(table.data(), 0, table.size() * sizeof(TTEntry));
     }
 
     void TranspositionTable::resize(U16 size) {
-        U32 num_entries = (size * 0x100000 / sizeof(TTEntry)) - 2;
+        const std::size_t num_entries =
+            (static_cast<std::size_t>(size) * 0x100000 / sizeof(TTEntry)) - 2;
         table.resize(num_entries);
         clear_tt();
     }
@@ -31,46 +34,54 @@ namespace elixir {
 
         if (table.empty())
             return false;
-        U32 index     = get_index(key);
-        TTEntry entry = table[index];
+        const TTEntry &entry = table[get_index(key)];
 
         flag = TT_NONE;
 
-        if (entry.key == key) {
+        if (entry.key == get_verification_key(key) && entry.flag() != TT_NONE) {
             result.best_move = entry.move;
             result.score     = entry.score;
+            result.eval      = entry.eval;
             result.depth     = entry.depth;
-            flag             = entry.flag;
+            flag             = entry.flag();
             return true;
         }
         return false;
     }
 
-    void TranspositionTable::store_tt(U64 key, int score, move::Move move, U8 depth, int ply,
-                                      TTFlag flag, search::PVariation pv) {
-        U32 index     = get_index(key);
-        TTEntry entry = table[index];
+    void TranspositionTable::store_tt(U64 key, int score, int eval, move::Move move, U8 depth,
+                                      int ply, TTFlag flag) {
+        TTEntry &entry       = table[get_index(key)];
+        const U16 verify_key = get_verification_key(key);
 
-        bool replace = entry.key != key || entry.depth < depth + 2 || flag == TT_EXACT;
+        bool replace = entry.key != verify_key || entry.age() != age || entry.depth < depth + 2 ||
+                       flag == TT_EXACT;
 
         if (! replace)
             return;
 
-        if (entry.depth == -1)
-            entries++;
-
         if (score > MATE)
             score += ply;
         else if (score < -MATE)
             score -= ply;
 
-        entry.key   = key;
-        entry.score = score;
-        entry.move  = move;
-        entry.depth = depth;
-        entry.flag  = flag;
+        entry.key      = verify_key;
+        entry.score    = score;
+        entry.eval     = eval;
+        entry.move     = move;
+        entry.depth    = depth;
+        entry.age_flag = (age << 2) | flag;
+    }
 
-        table[index] = entry;
+    U32 TranspositionTable::get_hashfull() const {
+        // Sample the first thousand entries for ones written by the current search
+        const std::size_t samples = std::min<std::size_t>(1000, table.size());
+        U32 used                  = 0;
+        for (std::size_t i = 0; i < samples; i++) {
+            if (table[i].flag() != TT_NONE && table[i].age() == age)
+                used++;
+        }
+        return used * 1000 / samples;
     }
 
 }
\ No newline at end of file
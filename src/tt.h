@@ -1,5 +1,6 @@
 #pragma once
 
+#include <type_traits>
 #include <vector>
 
 #include "defs.h"
@@ -11,35 +12,35 @@
 namespace elixir {
     enum TTFlag : U8 { TT_NONE, TT_EXACT, TT_ALPHA, TT_BETA };
 
+    /*
+    | A packed 10 byte entry. Only the low 16 bits of the key are kept for verification, the  |
+    | rest of the key is implied by the index. The bound lives in the low 2 bits of age_flag, |
+    | the search generation that wrote the entry in the upper 6 bits. An empty entry is all   |
+    | zeros, marked by TT_NONE, so the table can be cleared with memset.                      |
+    */
     struct TTEntry {
-        U64 key         = 0ULL;
-        I16 score       = 0;
+        U16 key         = 0;
         move::Move move = move::NO_MOVE;
-        I8 depth        = -1;
-        TTFlag flag     = TT_NONE;
+        I16 score       = 0;
+        I16 eval        = 0;
+        I8 depth        = 0;
+        U8 age_flag     = TT_NONE;
 
-        bool operator==(const TTEntry &other) const {
-            return key == other.key && score == other.score && depth == other.depth &&
-                   flag == other.flag;
-        }
-        bool operator==(const U64 &other) const { return key == other; }
+        [[nodiscard]] TTFlag flag() const { return static_cast<TTFlag>(age_flag & 0x3); }
+        [[nodiscard]] U8 age() const { return age_flag >> 2; }
     };
 
+    static_assert(sizeof(TTEntry) == 10);
+    static_assert(std::is_trivially_copyable_v<TTEntry>);
+
     struct ProbedEntry {
         int score;
+        int eval;
         move::Move best_move;
         U8 depth;
         TTFlag flag;
 
-        ProbedEntry() : score(0), best_move(move::NO_MOVE), depth(0), flag(TT_NONE) {}
-
-        ProbedEntry operator=(const TTEntry &entry) {
-            score     = entry.score;
-            best_move = entry.move;
-            depth     = entry.depth;
-            flag      = entry.flag;
-            return *this;
-        }
+        ProbedEntry() : score(0), eval(INF), best_move(move::NO_MOVE), depth(0), flag(TT_NONE) {}
     };
 
     class TranspositionTable {
@@ -48,17 +49,21 @@ namespace elixir {
         ~TranspositionTable() = default;
         void clear_tt();
         void resize(U16 size);
-        void store_tt(U64 key, int score, move::Move move, U8 depth, int ply, TTFlag flag,
-                      search::PVariation pv);
+        void new_search() { age = (age + 1) & 0x3f; }
+        void store_tt(U64 key, int score, int eval, move::Move move, U8 depth, int ply,
+                      TTFlag flag);
         bool probe_tt(ProbedEntry &result, U64 key, U8 depth, int alpha, int beta, TTFlag &flag);
-        U32 get_hashfull() {
-            return static_cast<U32>(static_cast<F64>(entries) / static_cast<F64>(table.capacity()) *
-                                    1000.0);
-        }
+        U32 get_hashfull() const;
 
       private:
-        U32 get_index(U64 key) const { return key % table.size(); }
-        std::size_t entries;
+        // Index with the high bits of the key, the low 16 bits are left for verification
+        std::size_t get_index(U64 key) const {
+            return static_cast<std::size_t>((static_cast<unsigned __int128>(key) * table.size()) >>
+                                            64);
+        }
+        static U16 get_verification_key(U64 key) { return static_cast<U16>(key); }
+
+        U8 age = 0;
         std::vector<TTEntry> table;
     };
 
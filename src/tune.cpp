@@ -5,6 +5,7 @@
 #include "movepicker.h"
 #include "search.h"
 #include "tune.h"
+#include "utils/sync_out.h"
 #endif
 
 namespace elixir {
@@ -24,18 +25,16 @@ namespace elixir::tune {
     void Tuner::print_info() {
         for (auto &field : fields) {
             const bool is_int = std::holds_alternative<int>(field.default_value);
-            std::cout << "option name " << field.name;
-            std::cout << " type " << (is_int ? "spin" : "string");
-            std::cout << " default "
-                      << (is_int ? std::get<int>(field.default_value)
-                                 : std::get<double>(field.default_value));
-            std::cout << " min "
-                      << (is_int ? std::get<int>(field.min_value)
-                                 : std::get<double>(field.min_value));
-            std::cout << " max "
-                      << (is_int ? std::get<int>(field.max_value)
-                                 : std::get<double>(field.max_value));
-            std::cout << std::endl;
+            SyncOut out;
+            out << "option name " << field.name;
+            out << " type " << (is_int ? "spin" : "string");
+            out << " default "
+                << (is_int ? std::get<int>(field.default_value)
+                           : std::get<double>(field.default_value));
+            out << " min "
+                << (is_int ? std::get<int>(field.min_value) : std::get<double>(field.min_value));
+            out << " max "
+                << (is_int ? std::get<int>(field.max_value) : std::get<double>(field.max_value));
         }
     }
 
@@ -63,6 +62,10 @@ namespace elixir::tune {
         tuner.add_field({"MP_QUEEN", &MP_QUEEN, 905, 500, 1300, 40, 0.002});
         tuner.add_field({"MP_KING", &MP_KING, 20903, 10000, 30000, 500, 0.002});
         tuner.add_field({"MP_SEE", &MP_SEE, 109, 20, 500, 5, 0.002});
+        tuner.add_field(
+            {"MP_CAPTURE_HISTORY_DIVISOR", &MP_CAPTURE_HISTORY_DIVISOR, 32, 4, 128, 4, 0.002});
+        tuner.add_field({"SEE_CAPTURE_HISTORY_DIVISOR", &SEE_CAPTURE_HISTORY_DIVISOR, 32, 8, 128,
+                         4, 0.002});
 
         // history terms
         tuner.add_field({"HISTORY_GRAVITY", &HISTORY_GRAVITY, 8289, 1024, 16384, 32, 0.002});
@@ -70,6 +73,14 @@ namespace elixir::tune {
         // time management terms
         tuner.add_field({"DEFAULT_MOVESTOGO", &DEFAULT_MOVESTOGO, 19, 5, 50, 1, 0.002});
         tuner.add_field({"DEFAULT_MOVE_OVERHEAD", &DEFAULT_MOVE_OVERHEAD, 48, 5, 150, 5, 0.002});
+        tuner.add_field({"TM_STABILITY_BASE", &TM_STABILITY_BASE, 1.5, 1.0, 3.0, 0.1, 0.002});
+        tuner.add_field({"TM_STABILITY_STEP", &TM_STABILITY_STEP, 0.15, 0.0, 0.3, 0.02, 0.002});
+        tuner.add_field(
+            {"TM_SCORE_MULTIPLIER", &TM_SCORE_MULTIPLIER, 0.012, 0.0, 0.05, 0.002, 0.002});
+        tuner.add_field(
+            {"TM_SINGLE_MOVE_SCALE", &TM_SINGLE_MOVE_SCALE, 0.1, 0.01, 1.0, 0.05, 0.002});
+        tuner.add_field({"TM_NODE_BASE", &TM_NODE_BASE, 1.5, 1.0, 2.5, 0.05, 0.002});
+        tuner.add_field({"TM_NODE_MULTIPLIER", &TM_NODE_MULTIPLIER, 1.35, 0.5, 2.5, 0.05, 0.002});
 
         // see terms
         tuner.add_field({"SEE_PAWN", &SEE_PAWN, 77, 20, 300, 5, 0.002});
@@ -257,6 +268,16 @@ namespace elixir::tune {
             MP_SEE     = mp_see;
         }
 
+        else if (name == "MP_CAPTURE_HISTORY_DIVISOR") {
+            int mp_capture_history_divisor = std::stoi(option_value);
+            MP_CAPTURE_HISTORY_DIVISOR     = mp_capture_history_divisor;
+        }
+
+        else if (name == "SEE_CAPTURE_HISTORY_DIVISOR") {
+            int see_capture_history_divisor     = std::stoi(option_value);
+            search::SEE_CAPTURE_HISTORY_DIVISOR = see_capture_history_divisor;
+        }
+
         else if (name == "MIN_ASP_DEPTH") {
             int min_asp_depth     = std::stoi(option_value);
             search::MIN_ASP_DEPTH = min_asp_depth;
@@ -272,6 +293,36 @@ namespace elixir::tune {
             DEFAULT_MOVE_OVERHEAD     = default_move_overhead;
         }
 
+        else if (name == "TM_STABILITY_BASE") {
+            float tm_stability_base   = std::stof(option_value);
+            search::TM_STABILITY_BASE = tm_stability_base;
+        }
+
+        else if (name == "TM_STABILITY_STEP") {
+            float tm_stability_step   = std::stof(option_value);
+            search::TM_STABILITY_STEP = tm_stability_step;
+        }
+
+        else if (name == "TM_SCORE_MULTIPLIER") {
+            float tm_score_multiplier   = std::stof(option_value);
+            search::TM_SCORE_MULTIPLIER = tm_score_multiplier;
+        }
+
+        else if (name == "TM_SINGLE_MOVE_SCALE") {
+            float tm_single_move_scale   = std::stof(option_value);
+            search::TM_SINGLE_MOVE_SCALE = tm_single_move_scale;
+        }
+
+        else if (name == "TM_NODE_BASE") {
+            float tm_node_base   = std::stof(option_value);
+            search::TM_NODE_BASE = tm_node_base;
+        }
+
+        else if (name == "TM_NODE_MULTIPLIER") {
+            float tm_node_multiplier   = std::stof(option_value);
+            search::TM_NODE_MULTIPLIER = tm_node_multiplier;
+        }
+
         else if (name == "HISTORY_GRAVITY") {
             int history_gravity = std::stoi(option_value);
             HISTORY_GRAVITY     = history_gravity;
@@ -323,4 +374,4 @@ namespace elixir::tune {
         }
     }
 }
-#endif
\ No newline at end of file
+#endif
\ No newline at end of file
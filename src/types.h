@@ -19,7 +19,7 @@ namespace elixir {
     using F64 = double;
 
     using Castling  = std::uint8_t;
-    using Move_T    = std::uint32_t;
+    using Move_T    = std::uint16_t;
     using EvalScore = std::int32_t;
     using Score     = std::int16_t;
     using PhaseType = std::uint8_t;
@@ -2,26 +2,64 @@
 #include <chrono>
 #include <iostream>
 #include <string>
+#include <thread>
 #include <vector>
 
 #include "uci.h"
 
 #include "bench/bench.h"
+#include "book/book.h"
 #include "evaluate.h"
 #include "history.h"
+#include "move.h"
+#include "movegen.h"
 #include "movepicker.h"
 #include "search.h"
+#include "tests/repetition_test.h"
 #include "tests/see_test.h"
 #include "tt.h"
 #include "tune.h"
 #include "utils/perft.h"
 #include "utils/str_utils.h"
+#include "utils/sync_out.h"
 #include "utils/test_fens.h"
 
 #define version "1.0"
 
 namespace elixir::uci {
 
+    /*
+    | Searches run on their own thread so that the UCI loop keeps reading commands. The thread |
+    | works on copies of the board and search info, so the loop never races with it.           |
+    */
+    std::thread search_thread;
+    Board search_board;
+    search::SearchInfo search_info;
+
+    /*
+    | Clock state of the last "go ponder", used to set the real time limits on ponderhit. |
+    */
+    F64 ponder_time = 0, ponder_inc = 0, ponder_movetime = 0;
+    int ponder_movestogo = -1;
+
+    int multipv = DEFAULT_MULTIPV;
+
+    void stop_search() {
+        search::stop_flag.store(true, std::memory_order_relaxed);
+        if (search_thread.joinable())
+            search_thread.join();
+        search::stop_flag.store(false, std::memory_order_relaxed);
+        search::ponder_flag.store(false, std::memory_order_relaxed);
+    }
+
+    void start_search(const Board &board, const search::SearchInfo &info, bool ponder) {
+        stop_search();
+        search::ponder_flag.store(ponder, std::memory_order_relaxed);
+        search_board  = board;
+        search_info   = info;
+        search_thread = std::thread([] { search::search(search_board, search_info); });
+    }
+
     void optimum_time(search::SearchInfo &info, F64 time, F64 inc, int movestogo,
                       std::chrono::high_resolution_clock::time_point start_time) {
         if (time < 0)
@@ -44,6 +82,26 @@ namespace elixir::uci {
         info = search::SearchInfo(MAX_DEPTH, start_time, soft_bound, hard_bound);
     }
 
+    void ponderhit() {
+        if (! search::ponder_flag.load(std::memory_order_relaxed))
+            return;
+
+        /*
+        | The opponent played the expected move, so the clock starts now. Only the time fields are |
+        | touched; the search thread reads them once it sees the cleared ponder flag.              |
+        */
+        if (search_info.timed) {
+            const auto now = std::chrono::high_resolution_clock::now();
+            search::SearchInfo limits(MAX_DEPTH, now, ponder_movetime, ponder_movetime);
+            if (ponder_movetime == 0)
+                optimum_time(limits, ponder_time, ponder_inc, ponder_movestogo, now);
+            search_info.start_time = limits.start_time;
+            search_info.soft_limit = limits.soft_limit;
+            search_info.hard_limit = limits.hard_limit;
+        }
+        search::ponder_flag.store(false, std::memory_order_release);
+    }
+
     void parse_position(std::string input, Board &board) {
         if (input.substr(9, 8) == "startpos") {
             board.from_fen(start_position);
@@ -84,8 +142,11 @@ namespace elixir::uci {
         std::vector<std::string> tokens = str_utils::split(input, ' ');
         search::SearchInfo info;
         const auto start_time = std::chrono::high_resolution_clock::now();
-        int depth = MAX_DEPTH, movestogo = -1;
-        F64 time = 0, inc = 0;
+        int depth = MAX_DEPTH, movestogo = -1, mate = 0;
+        F64 time = 0, inc = 0, movetime = 0;
+        U64 nodes = 0;
+        bool ponder = false, infinite = false;
+        MoveList search_moves;
         // If there are no tokens after "go" command, return
         if (tokens.size() <= 1)
             return;
@@ -100,11 +161,36 @@ namespace elixir::uci {
                 const int depth = std::stoi(tokens[++i]);
                 long long nodes = 0;
                 perft_driver(board, depth, nodes);
-                std::cout << "Nodes: " << nodes << std::endl;
+                sync_cout() << "Nodes: " << nodes;
                 return;
+            } else if (tokens[i] == "ponder") {
+                ponder = true;
+            } else if (tokens[i] == "nodes" && ++i < tokens.size()) {
+                nodes = std::stoull(tokens[i]);
+            } else if (tokens[i] == "movetime" && ++i < tokens.size()) {
+                movetime = std::max<F64>(std::stoi(tokens[i]), 1.0);
+            } else if (tokens[i] == "mate" && ++i < tokens.size()) {
+                mate = std::stoi(tokens[i]);
+            } else if (tokens[i] == "searchmoves") {
+                /*
+                | searchmoves takes every following token that is a legal move in this position. |
+                | Tokens are matched by their text, so "depth" or a bad square never gets parsed. |
+                */
+                MoveList legal_moves;
+                movegen::generate_moves<false>(board, legal_moves);
+                while (i + 1 < tokens.size()) {
+                    const auto move = std::find_if(
+                        legal_moves.begin(), legal_moves.end(),
+                        [&](const move::Move m) { return m.to_uci() == tokens[i + 1]; });
+                    if (move == legal_moves.end())
+                        break;
+                    search_moves.push(*move);
+                    i++;
+                }
             } else {
                 if (tokens[i] == "infinite") {
-                    search::SearchInfo info(MAX_DEPTH);
+                    depth    = MAX_DEPTH;
+                    infinite = true;
                 } else if ((tokens[i] == "wtime" || tokens[i] == "btime") &&
                            ++i < (int)tokens.size() &&
                            tokens[i - 1] ==
@@ -127,13 +213,39 @@ namespace elixir::uci {
             }
         }
 
-        if (time != 0) {
+        /*
+        | Play straight from the opening book if the position is in it, without searching. |
+        */
+        if (book::book.enabled && ! ponder && ! infinite) {
+            const move::Move book_move = book::book.probe(board);
+            if (book_move != move::NO_MOVE) {
+                sync_cout() << "bestmove " << book_move.to_uci();
+                return;
+            }
+        }
+
+        if (movetime != 0) {
+            info            = search::SearchInfo(depth, start_time, movetime, movetime);
+            info.fixed_time = true;
+        } else if (time != 0) {
             optimum_time(info, time, inc, movestogo, start_time);
+            info.depth = depth;
         } else {
             info = search::SearchInfo(depth);
         }
 
-        search::search(board, info);
+        info.multipv      = multipv;
+        info.node_limit   = nodes;
+        info.mate_limit   = mate;
+        info.search_moves = search_moves;
+        info.infinite     = infinite;
+
+        ponder_movetime  = movetime;
+        ponder_time      = time;
+        ponder_inc       = inc;
+        ponder_movestogo = movestogo;
+
+        start_search(board, info, ponder);
     }
 
     void parse_setoption(std::string input) {
@@ -150,6 +262,30 @@ namespace elixir::uci {
                 tt->resize(tt_size);
             }
 
+            else if (tokens[2] == "MultiPV") {
+                multipv = std::clamp<int>(std::stoi(option_value), MIN_MULTIPV, MAX_MULTIPV);
+            }
+
+            else if (tokens[2] == "OwnBook") {
+                book::book.enabled = option_value == "true";
+            }
+
+            else if (tokens[2] == "BookFile") {
+                // Book paths may contain spaces, so take the rest of the line after the "value"
+                // token, skipping any extra spaces in front of the path
+                std::size_t value_pos = 0;
+                for (int i = 0; i < 4; i++)
+                    value_pos += tokens[i].length() + 1;
+                const std::size_t path_pos = input.find_first_not_of(' ', value_pos);
+                if (path_pos == std::string::npos)
+                    return;
+                std::string path = input.substr(path_pos);
+                if (path == "<empty>")
+                    book::book.close();
+                else if (! book::book.open(path))
+                    sync_cout() << "info string Could not open book " << path;
+            }
+
             else {
 #ifdef USE_TUNE
                 tune::tuner.update_parameter(tokens[2], option_value);
@@ -161,37 +297,60 @@ namespace elixir::uci {
     void uci_loop(Board &board) {
         while (true) {
             std::string input;
-            std::getline(std::cin, input);
+            if (! std::getline(std::cin, input))
+                input = "quit";
+
             if (input == "uci") {
-                std::cout << "id name Elixir " << version << std::endl;
-                std::cout << "id author Arjun Basandrai" << std::endl;
-                std::cout << "option name Hash type spin default " << DEFAULT_HASH_SIZE << " min "
-                          << MIN_HASH << " max " << MAX_HASH << std::endl;
-                std::cout << "option name Threads type spin default 1 min 1 max 1" << std::endl;
+                sync_cout() << "id name Elixir " << version;
+                sync_cout() << "id author Arjun Basandrai";
+                sync_cout() << "option name Hash type spin default " << DEFAULT_HASH_SIZE << " min "
+                            << MIN_HASH << " max " << MAX_HASH;
+                sync_cout() << "option name Threads type spin default 1 min 1 max 1";
+                sync_cout() << "option name MultiPV type spin default " << DEFAULT_MULTIPV
+                            << " min " << MIN_MULTIPV << " max " << MAX_MULTIPV;
+                sync_cout() << "option name Ponder type check default false";
+                sync_cout() << "option name OwnBook type check default false";
+                sync_cout() << "option name BookFile type string default <empty>";
 #ifdef USE_TUNE
                 tune::tuner.print_info();
 #endif
-                std::cout << "uciok" << std::endl;
+                sync_cout() << "uciok";
             } else if (input == "isready") {
-                std::cout << "readyok" << std::endl;
+                sync_cout() << "readyok";
+            } else if (input == "ponderhit") {
+                ponderhit();
+            } else if (input == "stop") {
+                stop_search();
             } else if (input == "quit") {
+                stop_search();
                 break;
             } else if (input == "ucinewgame") {
+                stop_search();
                 board.from_fen(start_position);
                 tt->clear_tt();
+                history->clear();
             } else if (input == "bench") {
+                stop_search();
                 bench::bench();
-                break;
+            } else if (input == "qbench") {
+                stop_search();
+                bench::qsearch_bench();
             } else if (input == "see") {
+                stop_search();
                 tests::see_test();
-                break;
+            } else if (input == "repetition") {
+                stop_search();
+                tests::repetition_test();
             } else if (input == "print") {
                 board.print_board();
             } else if (input.substr(0, 9) == "position ") {
+                stop_search();
                 parse_position(input, board);
             } else if (input.substr(0, 2) == "go") {
+                stop_search();
                 parse_go(input, board);
             } else if (input.substr(0, 9) == "setoption") {
+                stop_search();
                 parse_setoption(input);
             }
         }
@@ -15,7 +15,8 @@ namespace elixir {
             nodes++;
             return;
         }
-        MoveList moves = movegen::generate_moves<false>(board);
+        MoveList moves;
+        movegen::generate_moves<false>(board, moves);
         for (auto m : moves) {
             if (! board.make_move(m)) {
                 continue;
@@ -27,9 +28,10 @@ namespace elixir {
     }
 
     void perft_test(Board &board, int depth, long long &nodes) {
-        nodes          = 0;
-        MoveList moves = movegen::generate_moves<false>(board);
-        auto start     = std::chrono::high_resolution_clock::now();
+        nodes = 0;
+        MoveList moves;
+        movegen::generate_moves<false>(board, moves);
+        auto start = std::chrono::high_resolution_clock::now();
         for (auto m : moves) {
 
             if (! board.make_move(m)) {
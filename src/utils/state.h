@@ -8,13 +8,16 @@ namespace elixir {
     struct State {
         State() = default;
         State(const U64 &hash_key, const Castling &castling_rights, const Square &enpass,
-              const I8 &fifty_move_counter, const Piece &captured_piece, const EvalScore &eval)
+              const I8 &fifty_move_counter, const I16 &plies_from_null, const Piece &captured_piece,
+              const EvalScore &eval)
             : hash_key(hash_key), castling_rights(castling_rights), enpass(enpass),
-              fifty_move_counter(fifty_move_counter), captured_piece(captured_piece), eval(eval) {}
+              fifty_move_counter(fifty_move_counter), plies_from_null(plies_from_null),
+              captured_piece(captured_piece), eval(eval) {}
         U64 hash_key;
         Castling castling_rights;
         Square enpass;
         I8 fifty_move_counter;
+        I16 plies_from_null;
         Piece captured_piece;
         EvalScore eval;
     };
@@ -5,10 +5,17 @@
 #include <array>
 #include <cassert>
 #include <cstddef>
+#include <type_traits>
 
+// The buffer sits in a union so that constructing a vector leaves it uninitialised; only the
+// first m_size elements are ever read. This keeps the move lists and score buffers that every
+// node puts on the stack free to construct.
 template <typename T, std::size_t Capacity> class StaticVector {
+    static_assert(std::is_trivially_copyable_v<T> && std::is_trivially_destructible_v<T>,
+                  "StaticVector never constructs or destroys its elements");
+
   public:
-    StaticVector()  = default;
+    StaticVector() {}
     ~StaticVector() = default;
 
     StaticVector(const StaticVector<T, Capacity> &other) { *this = other; }
@@ -29,6 +36,9 @@ template <typename T, std::size_t Capacity> class StaticVector {
 
     [[nodiscard]] auto empty() const { return m_size == 0; }
 
+    // Raw storage, for writers that fill several elements at once and then resize
+    [[nodiscard]] auto data() noexcept { return m_data.data(); }
+
     [[nodiscard]] auto operator[](std::size_t i) const -> const auto & {
         assert(i < m_size);
         return m_data[i];
@@ -59,6 +69,8 @@ template <typename T, std::size_t Capacity> class StaticVector {
     }
 
   private:
-    std::array<T, Capacity> m_data{};
+    union {
+        std::array<T, Capacity> m_data;
+    };
     std::size_t m_size{0};
 };
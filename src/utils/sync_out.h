@@ -0,0 +1,36 @@
+#pragma once
+
+#include <iostream>
+#include <mutex>
+#include <sstream>
+
+namespace elixir {
+    /*
+    | The UCI thread and the search thread both write to the GUI. Each line is built in its own |
+    | buffer and written out whole under one lock when the writer goes away, so lines from the  |
+    | two threads can never interleave.                                                         |
+    */
+    inline std::mutex cout_mutex;
+
+    class SyncOut {
+      public:
+        SyncOut()                = default;
+        SyncOut(const SyncOut &) = delete;
+        ~SyncOut() {
+            std::lock_guard<std::mutex> lock(cout_mutex);
+            std::cout << buffer.str() << std::endl;
+        }
+
+        template <typename T>
+        SyncOut &operator<<(const T &value) {
+            buffer << value;
+            return *this;
+        }
+
+      private:
+        std::ostringstream buffer;
+    };
+
+    // One UCI line: sync_cout() << "readyok";
+    inline SyncOut sync_cout() { return SyncOut(); }
+}